@@ -1,83 +1,91 @@
-/* USER CODE BEGIN Header */
-/**
-  ******************************************************************************
-  * @file           : main.h
-  * @brief          : Header for main.c file.
-  *                   This file contains the common defines of the application.
-  ******************************************************************************
-  * @attention
-  *
-  * Copyright (c) 2025 STMicroelectronics.
-  * All rights reserved.
-  *
-  * This software is licensed under terms that can be found in the LICENSE file
-  * in the root directory of this software component.
-  * If no LICENSE file comes with this software, it is provided AS-IS.
-  *
-  ******************************************************************************
-  */
-/* USER CODE END Header */
-
-/* Define to prevent recursive inclusion -------------------------------------*/
-#ifndef __MAIN_H
-#define __MAIN_H
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-/* Includes ------------------------------------------------------------------*/
-#include "stm32f0xx_hal.h"
-
-/* Private includes ----------------------------------------------------------*/
-/* USER CODE BEGIN Includes */
-
-/* USER CODE END Includes */
-
-/* Exported types ------------------------------------------------------------*/
-/* USER CODE BEGIN ET */
-
-/* USER CODE END ET */
-
-/* Exported constants --------------------------------------------------------*/
-/* USER CODE BEGIN EC */
-
-/* USER CODE END EC */
-
-/* Exported macro ------------------------------------------------------------*/
-/* USER CODE BEGIN EM */
-
-/* USER CODE END EM */
-
-/* Exported functions prototypes ---------------------------------------------*/
-void Error_Handler(void);
-
-/* USER CODE BEGIN EFP */
-
-/* USER CODE END EFP */
-
-/* Private defines -----------------------------------------------------------*/
-#define IR_LED_Pin GPIO_PIN_0
-#define IR_LED_GPIO_Port GPIOA
-#define DISP_LAT_Pin GPIO_PIN_4
-#define DISP_LAT_GPIO_Port GPIOA
-#define DISP_CLK_Pin GPIO_PIN_5
-#define DISP_CLK_GPIO_Port GPIOA
-#define POT_Pin GPIO_PIN_6
-#define POT_GPIO_Port GPIOA
-#define DISP_DATA_Pin GPIO_PIN_7
-#define DISP_DATA_GPIO_Port GPIOA
-#define SW_Pin GPIO_PIN_1
-#define SW_GPIO_Port GPIOB
-#define RED_LED_Pin GPIO_PIN_10
-#define RED_LED_GPIO_Port GPIOA
-
-/* USER CODE BEGIN Private defines */
-
-/* USER CODE END Private defines */
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* __MAIN_H */
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : main.h
+  * @brief          : Header for main.c file.
+  *                   This file contains the common defines of the application.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f0xx_hal.h"
+
+/* Private includes ----------------------------------------------------------*/
+/* USER CODE BEGIN Includes */
+
+/* USER CODE END Includes */
+
+/* Exported types ------------------------------------------------------------*/
+/* USER CODE BEGIN ET */
+
+/* USER CODE END ET */
+
+/* Exported constants --------------------------------------------------------*/
+/* USER CODE BEGIN EC */
+
+/* USER CODE END EC */
+
+/* Exported macro ------------------------------------------------------------*/
+/* USER CODE BEGIN EM */
+
+/* USER CODE END EM */
+
+/* Exported functions prototypes ---------------------------------------------*/
+void Error_Handler(void);
+
+/* USER CODE BEGIN EFP */
+
+/* USER CODE END EFP */
+
+/* Private defines -----------------------------------------------------------*/
+#define IR_LED_Pin GPIO_PIN_0
+#define IR_LED_GPIO_Port GPIOA
+#define DISP_LAT_Pin GPIO_PIN_4
+#define DISP_LAT_GPIO_Port GPIOA
+#define DISP_CLK_Pin GPIO_PIN_5
+#define DISP_CLK_GPIO_Port GPIOA
+#define POT_Pin GPIO_PIN_6
+#define POT_GPIO_Port GPIOA
+#define DISP_DATA_Pin GPIO_PIN_7
+#define DISP_DATA_GPIO_Port GPIOA
+#define SW_Pin GPIO_PIN_1
+#define SW_GPIO_Port GPIOB
+#define RED_LED_Pin GPIO_PIN_10
+#define RED_LED_GPIO_Port GPIOA
+
+/* USER CODE BEGIN Private defines */
+#ifdef BOARD_IR_LED_PA10
+/* IR LED reworked to PA10 (TIM1_CH3) for the PWM transmit engine,
+   the red LED takes its place on PA0 */
+#undef IR_LED_Pin
+#define IR_LED_Pin GPIO_PIN_10
+#undef RED_LED_Pin
+#define RED_LED_Pin GPIO_PIN_0
+#endif
+
+/* USER CODE END Private defines */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
@@ -1,252 +1,758 @@
-/* USER CODE BEGIN Header */
-/**
- ******************************************************************************
- * @file           : main.c
- * @brief          : Main program body
- ******************************************************************************
- * @attention
- *
- * Copyright (c) 2025 STMicroelectronics.
- * All rights reserved.
- *
- * This software is licensed under terms that can be found in the LICENSE file
- * in the root directory of this software component.
- * If no LICENSE file comes with this software, it is provided AS-IS.
- *
- ******************************************************************************
- */
-/* USER CODE END Header */
-/* Includes ------------------------------------------------------------------*/
-#include "main.h"
-#include "adc.h"
-#include "spi.h"
-#include "tim.h"
-#include "usart.h"
-#include "gpio.h"
-
-/* Private includes ----------------------------------------------------------*/
-/* USER CODE BEGIN Includes */
-#include <stdio.h>
-#include <math.h>
-
-#include "display.h"
-#include "midea_ir.h"
-/* USER CODE END Includes */
-
-/* Private typedef -----------------------------------------------------------*/
-/* USER CODE BEGIN PTD */
-
-/* USER CODE END PTD */
-
-/* Private define ------------------------------------------------------------*/
-/* USER CODE BEGIN PD */
-
-/* USER CODE END PD */
-
-/* Private macro -------------------------------------------------------------*/
-/* USER CODE BEGIN PM */
-
-/* USER CODE END PM */
-
-/* Private variables ---------------------------------------------------------*/
-
-/* USER CODE BEGIN PV */
-
-MideaIR ir;
-
-/* USER CODE END PV */
-
-/* Private function prototypes -----------------------------------------------*/
-void SystemClock_Config(void);
-/* USER CODE BEGIN PFP */
-
-/* USER CODE END PFP */
-
-/* Private user code ---------------------------------------------------------*/
-/* USER CODE BEGIN 0 */
-
-/* USER CODE END 0 */
-
-/**
- * @brief  The application entry point.
- * @retval int
- */
-int main(void)
-{
-
-  /* USER CODE BEGIN 1 */
-
-  /* USER CODE END 1 */
-
-  /* MCU Configuration--------------------------------------------------------*/
-
-  /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
-  HAL_Init();
-
-  /* USER CODE BEGIN Init */
-
-  /* USER CODE END Init */
-
-  /* Configure the system clock */
-  SystemClock_Config();
-
-  /* USER CODE BEGIN SysInit */
-
-  /* USER CODE END SysInit */
-
-  /* Initialize all configured peripherals */
-  MX_GPIO_Init();
-  MX_ADC_Init();
-  MX_SPI1_Init();
-  MX_TIM1_Init();
-  MX_USART2_UART_Init();
-  /* USER CODE BEGIN 2 */
-
-  midea_ir_init(&ir);
-  DisplayOff();
-  /* USER CODE END 2 */
-
-  /* Infinite loop */
-  /* USER CODE BEGIN WHILE */
-  while (1)
-  {
-    /* USER CODE END WHILE */
-
-    /* USER CODE BEGIN 3 */
-
-    uint16_t adc_val = 0;
-    HAL_ADC_Start(&hadc);
-    HAL_ADC_PollForConversion(&hadc, HAL_MAX_DELAY);
-    adc_val = HAL_ADC_GetValue(&hadc);
-
-    uint16_t target_temp = (adc_val / 160) + TEMP_LOW;
-    bool state = true; // on
-
-    if (target_temp > TEMP_HIGH)
-    {
-      target_temp = TEMP_HIGH;
-      state = false;
-    }
-    else if (target_temp < TEMP_LOW)
-    {
-      target_temp = TEMP_LOW;
-    }
-
-    if (state == true)
-    {
-      DisplayDecimal(target_temp);
-    }
-    else
-    {
-      DisplayHex(0x0F); // as OFF
-    }
-
-    /*uint8_t data[6];
-    uint16_t pows[4] = {1000, 100, 10, 1};
-    for(int i=0; i<4 ;i++){
-      data[i] = (adc_val / pows[i]) + '0';
-      adc_val = adc_val % pows[i];
-    }
-    data[4] = '\r';
-    data[5] = '\n';
-    HAL_UART_Transmit(&huart2, data, 6, HAL_MAX_DELAY);*/
-
-    ir.enabled = state;
-    ir.mode = MODE_AUTO;
-    ir.fan_level = 2;
-    ir.temperature = target_temp;
-
-    if (HAL_GPIO_ReadPin(SW_GPIO_Port, SW_Pin) == GPIO_PIN_RESET)
-    {
-      HAL_GPIO_WritePin(RED_LED_GPIO_Port, RED_LED_Pin, GPIO_PIN_SET);
-      midea_ir_send(&ir);
-      HAL_Delay(500);
-    }
-    else
-    {
-      HAL_GPIO_WritePin(RED_LED_GPIO_Port, RED_LED_Pin, GPIO_PIN_RESET);
-    }
-
-    HAL_Delay(100);
-  }
-  /* USER CODE END 3 */
-}
-
-/**
- * @brief System Clock Configuration
- * @retval None
- */
-void SystemClock_Config(void)
-{
-  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
-  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
-
-  /** Initializes the RCC Oscillators according to the specified parameters
-   * in the RCC_OscInitTypeDef structure.
-   */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI | RCC_OSCILLATORTYPE_HSI14;
-  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-  RCC_OscInitStruct.HSI14State = RCC_HSI14_ON;
-  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
-  RCC_OscInitStruct.HSI14CalibrationValue = 16;
-  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
-  RCC_OscInitStruct.PLL.PLLMUL = RCC_PLL_MUL4;
-  RCC_OscInitStruct.PLL.PREDIV = RCC_PREDIV_DIV1;
-  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
-  {
-    Error_Handler();
-  }
-
-  /** Initializes the CPU, AHB and APB buses clocks
-   */
-  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1;
-  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
-  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
-
-  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_1) != HAL_OK)
-  {
-    Error_Handler();
-  }
-}
-
-/* USER CODE BEGIN 4 */
-int __io_putchar(int ch)
-{
-  HAL_UART_Transmit(&huart2, (uint8_t *)&ch, 1, 0xFFFF);
-  return ch;
-}
-/* USER CODE END 4 */
-
-/**
- * @brief  This function is executed in case of error occurrence.
- * @retval None
- */
-void Error_Handler(void)
-{
-  /* USER CODE BEGIN Error_Handler_Debug */
-  /* User can add his own implementation to report the HAL error return state */
-  __disable_irq();
-  while (1)
-  {
-  }
-  /* USER CODE END Error_Handler_Debug */
-}
-
-#ifdef USE_FULL_ASSERT
-/**
- * @brief  Reports the name of the source file and the source line number
- *         where the assert_param error has occurred.
- * @param  file: pointer to the source file name
- * @param  line: assert_param error line source number
- * @retval None
- */
-void assert_failed(uint8_t *file, uint32_t line)
-{
-  /* USER CODE BEGIN 6 */
-  /* User can add his own implementation to report the file name and line number,
-     ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
-  /* USER CODE END 6 */
-}
-#endif /* USE_FULL_ASSERT */
+/* USER CODE BEGIN Header */
+/**
+ ******************************************************************************
+ * @file           : main.c
+ * @brief          : Main program body
+ ******************************************************************************
+ * @attention
+ *
+ * Copyright (c) 2025 STMicroelectronics.
+ * All rights reserved.
+ *
+ * This software is licensed under terms that can be found in the LICENSE file
+ * in the root directory of this software component.
+ * If no LICENSE file comes with this software, it is provided AS-IS.
+ *
+ ******************************************************************************
+ */
+/* USER CODE END Header */
+/* Includes ------------------------------------------------------------------*/
+#include "main.h"
+#include "adc.h"
+#include "dma.h"
+#include "spi.h"
+#include "tim.h"
+#include "usart.h"
+#include "gpio.h"
+
+/* Private includes ----------------------------------------------------------*/
+/* USER CODE BEGIN Includes */
+#include <stdio.h>
+#include <math.h>
+
+#include "display.h"
+#include "midea_ir.h"
+#include "scheduler.h"
+#include "button.h"
+#include "knob.h"
+#include "spi_bus.h"
+#ifdef CLOCK_SCALING
+#include "clock.h"
+#endif
+#ifdef CPU_TIME
+#include "cpu_time.h"
+#endif
+#ifdef DISPLAY_ANIM
+#include "anim.h"
+#endif
+/* USER CODE END Includes */
+
+/* Private typedef -----------------------------------------------------------*/
+/* USER CODE BEGIN PTD */
+
+/* USER CODE END PTD */
+
+/* Private define ------------------------------------------------------------*/
+/* USER CODE BEGIN PD */
+#define KNOB_PERIOD   20   // ms
+#define REPORT_PERIOD 10000 // ms
+#define STOP_IDLE_DELAY 30000 // ms without input before Stop mode
+#define CPU_TIME_POLL 100     // ms between two looks for a report request
+
+#ifdef DISPLAY_DIM
+#define DISPLAY_DIM_DELAY 10000 // ms without input before dimming the display
+#define DISPLAY_DIM_LEVEL 2     // of DISPLAY_LEVELS
+#endif
+#ifdef DISPLAY_ANIM
+#define STATUS_STEP  300 // ms per frame of the status shown after sending
+#define STATUS_BLINK 3
+#endif
+
+#ifdef AUTO_SEND
+/* Send the knob state by itself once it has not changed for the settle
+   time. A token bucket caps the airtime: at most AUTO_SEND_BURST frames
+   back to back, then one per AUTO_SEND_REFILL (a state frame with its
+   repeat is on air for ~250ms). */
+#ifndef AUTO_SEND_SETTLE
+#define AUTO_SEND_SETTLE 700 // ms
+#endif
+#define AUTO_SEND_BURST  3
+#define AUTO_SEND_REFILL 2000 // ms
+#endif
+/* USER CODE END PD */
+
+/* Private macro -------------------------------------------------------------*/
+/* USER CODE BEGIN PM */
+
+/* USER CODE END PM */
+
+/* Private variables ---------------------------------------------------------*/
+
+/* USER CODE BEGIN PV */
+
+MideaIR ir;
+MideaIR sent_ir;
+uint8_t displayed = 0xFF; // value on the display, 0xFF before the first one
+uint32_t last_input;      // HAL tick of the last button or knob change
+#ifdef SCHEDULER_REPORT
+uint32_t wake_stamp;      // scheduler_cycles() when the clock was back
+uint32_t wake_restore_us; // clock restore after the last wake from Stop
+uint32_t wake_to_ir_us;   // wake from Stop to IR start, 0 if not measured
+bool wake_pending;        // woke from Stop, no frame sent yet
+#endif
+#ifdef MIDEA_IR_ISR_BENCH
+bool bench_pending;
+#endif
+#ifdef AUTO_SEND
+uint8_t send_tokens = AUTO_SEND_BURST;
+uint32_t token_time; // HAL tick of the last token refill
+#endif
+#ifdef DISPLAY_ANIM
+char status_text[3]; // mode and fan level of the state sent
+Anim status_anim = {.kind = ANIM_BLINK, .text = status_text, .step = STATUS_STEP, .loops = STATUS_BLINK};
+const Anim off_anim = {.kind = ANIM_SCROLL, .text = "OFF", .step = STATUS_STEP, .loops = 1};
+#endif
+
+/* USER CODE END PV */
+
+/* Private function prototypes -----------------------------------------------*/
+void SystemClock_Config(void);
+/* USER CODE BEGIN PFP */
+static uint32_t SystemClock_Restore(void);
+static void knob_run(void);
+static void input_run(void);
+static void input_seen(void);
+#ifdef DISPLAY_DIM
+static void dim_run(void);
+#endif
+#ifdef DISPLAY_ANIM
+static void status_run(void);
+#endif
+#ifdef CLOCK_SCALING
+static void clock_run(void);
+#endif
+#ifdef AUTO_SEND
+static void auto_send_run(void);
+#endif
+#ifdef MIDEA_IR_ISR_BENCH
+static void bench_run(void);
+#endif
+#ifdef SCHEDULER_REPORT
+static void report_run(void);
+#endif
+#ifdef CPU_TIME
+static void cpu_time_run(void);
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+static void latency_run(void);
+#endif
+/* USER CODE END PFP */
+
+/* Private user code ---------------------------------------------------------*/
+/* USER CODE BEGIN 0 */
+
+#ifdef KNOB_AWD
+static SchedulerTask knob_task = SCHEDULER_TASK("knob", knob_run, 0);
+#else
+static SchedulerTask knob_task = SCHEDULER_TASK("knob", knob_run, KNOB_PERIOD);
+#endif
+static SchedulerTask input_task = SCHEDULER_TASK("input", input_run, 0);
+#ifdef DISPLAY_DIM
+static SchedulerTask dim_task = SCHEDULER_TASK("dim", dim_run, 0);
+#endif
+#ifdef DISPLAY_ANIM
+static SchedulerTask status_task = SCHEDULER_TASK("status", status_run, 0);
+#endif
+#ifdef CLOCK_SCALING
+static SchedulerTask clock_task = SCHEDULER_TASK("clock", clock_run, 0);
+#endif
+#ifdef AUTO_SEND
+static SchedulerTask auto_send_task = SCHEDULER_TASK("auto", auto_send_run, 0);
+#endif
+#ifdef MIDEA_IR_ISR_BENCH
+static SchedulerTask bench_task = SCHEDULER_TASK("bench", bench_run, 100);
+#endif
+#ifdef SCHEDULER_REPORT
+static SchedulerTask report_task = SCHEDULER_TASK("report", report_run, REPORT_PERIOD);
+#endif
+#ifdef CPU_TIME
+static SchedulerTask cpu_time_task = SCHEDULER_TASK("cpu", cpu_time_run, CPU_TIME_POLL);
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+static SchedulerTask latency_task = SCHEDULER_TASK("latency", latency_run, 0);
+#endif
+
+/* USER CODE END 0 */
+
+/**
+ * @brief  The application entry point.
+ * @retval int
+ */
+int main(void)
+{
+
+  /* USER CODE BEGIN 1 */
+
+  /* USER CODE END 1 */
+
+  /* MCU Configuration--------------------------------------------------------*/
+
+  /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
+  HAL_Init();
+
+  /* USER CODE BEGIN Init */
+
+  /* USER CODE END Init */
+
+  /* Configure the system clock */
+  SystemClock_Config();
+
+  /* USER CODE BEGIN SysInit */
+
+  /* USER CODE END SysInit */
+
+  /* Initialize all configured peripherals */
+  MX_GPIO_Init();
+  MX_DMA_Init();
+  MX_ADC_Init();
+  MX_SPI1_Init();
+  MX_TIM1_Init();
+  MX_USART2_UART_Init();
+  MX_TIM16_Init();
+  /* USER CODE BEGIN 2 */
+
+  midea_ir_init(&ir);
+  DisplayOff();
+  knob_init();
+#ifdef CLOCK_SCALING
+  clock_init();
+#endif
+
+  scheduler_add(&knob_task, KNOB_PERIOD); // let the knob samples fill up
+#ifdef KNOB_AWD
+  knob_watch(&knob_task);
+#endif
+  scheduler_add(&input_task, 0);
+  button_init(&input_task);
+#ifdef CLOCK_SCALING
+  scheduler_add(&clock_task, 0); // drops to CLOCK_IDLE
+#endif
+#ifdef MIDEA_IR_ISR_BENCH
+  scheduler_add(&bench_task, 0);
+#endif
+#ifdef SCHEDULER_REPORT
+  scheduler_add(&report_task, REPORT_PERIOD);
+#endif
+#ifdef CPU_TIME
+  scheduler_add(&cpu_time_task, CPU_TIME_POLL);
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+  scheduler_add(&latency_task, 0);
+#endif
+#ifdef DISPLAY_ANIM
+  scheduler_add(&status_task, 0);
+#endif
+  /* USER CODE END 2 */
+
+  /* Infinite loop */
+  /* USER CODE BEGIN WHILE */
+  while (1)
+  {
+    /* USER CODE END WHILE */
+
+    /* USER CODE BEGIN 3 */
+    scheduler_run();
+  }
+  /* USER CODE END 3 */
+}
+
+/**
+ * @brief System Clock Configuration
+ * @retval None
+ */
+void SystemClock_Config(void)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
+
+  /** Initializes the RCC Oscillators according to the specified parameters
+   * in the RCC_OscInitTypeDef structure.
+   */
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI | RCC_OSCILLATORTYPE_HSI14;
+  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
+  RCC_OscInitStruct.HSI14State = RCC_HSI14_ON;
+  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+  RCC_OscInitStruct.HSI14CalibrationValue = 16;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
+  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+  RCC_OscInitStruct.PLL.PLLMUL = RCC_PLL_MUL4;
+  RCC_OscInitStruct.PLL.PREDIV = RCC_PREDIV_DIV1;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  /** Initializes the CPU, AHB and APB buses clocks
+   */
+  RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK | RCC_CLOCKTYPE_PCLK1;
+  RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+  RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV1;
+
+  if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_1) != HAL_OK)
+  {
+    Error_Handler();
+  }
+}
+
+/* USER CODE BEGIN 4 */
+#ifdef CLOCK_SCALING
+/* The IR interrupt engine gets 48MHz while frames are sent, the rest of
+   the time is spent at 8MHz. Frames are only queued behind a frame in
+   flight, which already runs at 48MHz. */
+static void clock_run(void)
+{
+  if (!midea_ir_busy())
+  {
+    clock_set(CLOCK_IDLE);
+  }
+}
+#endif
+
+#if defined(CLOCK_SCALING) || defined(MIDEA_IR_ISR_LATENCY) || defined(DISPLAY_ANIM)
+void midea_ir_sent_callback(void)
+{
+#ifdef CLOCK_SCALING
+  scheduler_post(&clock_task);
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+  scheduler_post(&latency_task);
+#endif
+#ifdef DISPLAY_ANIM
+  scheduler_post(&status_task);
+#endif
+}
+#endif
+
+#ifdef DISPLAY_ANIM
+static char mode_glyph(MideaMode mode)
+{
+  switch (mode)
+  {
+  case MODE_COOL:
+    return 'C';
+  case MODE_HEAT:
+    return 'H';
+  case MODE_FAN:
+    return 'F';
+  default:
+    return 'A'; // MODE_DEHUMIDIFY has the same code
+  }
+}
+
+/* The spinner runs until the last queued frame is out, then the state
+   that was sent is shown: mode and fan level blinking, or OFF. */
+static void status_run(void)
+{
+  if (midea_ir_busy())
+  {
+    return;
+  }
+  if (!sent_ir.enabled)
+  {
+    anim_play(&off_anim);
+    return;
+  }
+  status_text[0] = mode_glyph(sent_ir.mode);
+  status_text[1] = '0' + sent_ir.fan_level;
+  anim_play(&status_anim);
+}
+#endif
+
+static inline void show_sending(void)
+{
+#ifdef DISPLAY_ANIM
+  if (anim_playing() != &anim_spinner)
+  {
+    anim_play(&anim_spinner);
+  }
+#endif
+}
+
+static inline void ir_clock_up(void)
+{
+#ifdef CLOCK_SCALING
+  if (!midea_ir_busy())
+  {
+    clock_set(CLOCK_FAST);
+  }
+#endif
+}
+
+static bool send_state(void)
+{
+  ir_clock_up();
+  if (!midea_ir_send(&ir))
+  { // queue full of deflector moves, sent_ir still differs for a retry
+    return false;
+  }
+  show_sending();
+  sent_ir = ir;
+#ifdef SCHEDULER_REPORT
+  if (wake_pending)
+  { // the first edge follows within one TIM1 update
+    wake_to_ir_us = (scheduler_cycles() - wake_stamp) / (SystemCoreClock / 1000000);
+    wake_pending = false;
+  }
+#endif
+#ifdef MIDEA_IR_ISR_BENCH
+  bench_pending = true;
+#endif
+  return true;
+}
+
+static void knob_run(void)
+{
+  uint8_t target_temp = knob_temperature();
+  bool state = target_temp != KNOB_OFF;
+#ifdef AUTO_SEND
+  bool first = displayed == 0xFF;
+#endif
+
+  if (!state)
+  {
+    target_temp = TEMP_HIGH;
+  }
+
+  uint8_t display = state ? target_temp : 0x0F;
+  if (display != displayed)
+  {
+    if (state == true)
+    {
+      DisplayDecimal(target_temp);
+    }
+    else
+    {
+      DisplayHex(0x0F); // as OFF
+    }
+    displayed = display;
+    input_seen();
+#ifdef DISPLAY_ANIM
+    if (anim_playing() != &anim_spinner)
+    { // the new temperature beats an old status
+      anim_stop();
+    }
+#endif
+#ifdef AUTO_SEND
+    if (!first)
+    {
+      scheduler_add(&auto_send_task, AUTO_SEND_SETTLE); // restarts the settle time
+    }
+#endif
+  }
+
+  ir.enabled = state;
+  ir.mode = MODE_AUTO;
+  ir.fan_level = 2;
+  ir.temperature = target_temp;
+#ifdef AUTO_SEND
+  if (first)
+  { // nothing is sent until the knob is turned, take it as the AC state
+    sent_ir = ir;
+  }
+#endif
+
+  // send every change while the button is held, the IR queue only keeps
+  // the latest state
+  if (button_pressed() && (ir.enabled != sent_ir.enabled || ir.temperature != sent_ir.temperature))
+  {
+    send_state();
+  }
+}
+
+#ifdef AUTO_SEND
+static void auto_send_run(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  if (ir.enabled == sent_ir.enabled && ir.temperature == sent_ir.temperature)
+  { // back where it was, nothing to send
+    return;
+  }
+
+  while (send_tokens < AUTO_SEND_BURST && now - token_time >= AUTO_SEND_REFILL)
+  {
+    send_tokens++;
+    token_time += AUTO_SEND_REFILL;
+  }
+  if (send_tokens == AUTO_SEND_BURST)
+  {
+    token_time = now;
+  }
+
+  if (!send_tokens)
+  { // try again with the next token
+    scheduler_add(&auto_send_task, AUTO_SEND_REFILL - (now - token_time));
+    return;
+  }
+
+  if (send_state())
+  {
+    send_tokens--;
+  }
+  else
+  { // the queue is full, the token is kept for the retry
+    scheduler_add(&auto_send_task, AUTO_SEND_REFILL);
+  }
+}
+#endif
+
+static void input_seen(void)
+{
+  last_input = HAL_GetTick();
+#ifdef DISPLAY_DIM
+  if (DisplayGetBrightness() != DISPLAY_LEVELS)
+  {
+    DisplaySetBrightness(DISPLAY_LEVELS);
+  }
+  scheduler_add(&dim_task, DISPLAY_DIM_DELAY);
+#endif
+}
+
+#ifdef DISPLAY_DIM
+static void dim_run(void)
+{
+  DisplaySetBrightness(DISPLAY_DIM_LEVEL);
+}
+#endif
+
+static void input_run(void)
+{
+  ButtonEvent event;
+
+  while (button_get_event(&event))
+  {
+    input_seen();
+    switch (event)
+    {
+    case BUTTON_PRESS:
+      HAL_GPIO_WritePin(RED_LED_GPIO_Port, RED_LED_Pin, GPIO_PIN_SET);
+      send_state();
+      break;
+    case BUTTON_RELEASE:
+      HAL_GPIO_WritePin(RED_LED_GPIO_Port, RED_LED_Pin, GPIO_PIN_RESET);
+      break;
+    case BUTTON_LONG_PRESS:
+      ir_clock_up();
+      if (midea_ir_move_deflector(&ir))
+      {
+        show_sending();
+      }
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+#ifdef MIDEA_IR_ISR_BENCH
+static void bench_run(void)
+{
+  if (bench_pending && !midea_ir_busy())
+  {
+    MideaIRBench bench;
+    midea_ir_bench(&bench);
+    printf("IR ISR: %u cycles max, done %u cycles after update, budget %u\r\n",
+           bench.max_cycles, bench.max_exit, bench.budget);
+    bench_pending = false;
+  }
+}
+#endif
+
+#ifdef SCHEDULER_REPORT
+static void report_run(void)
+{
+  scheduler_report();
+  if (wake_to_ir_us)
+  {
+    printf("stop wake: clock %lu us, to IR start %lu us\r\n",
+           wake_restore_us, wake_to_ir_us);
+    wake_to_ir_us = 0;
+  }
+#ifdef CLOCK_SCALING
+  ClockStats clock;
+  clock_stats(&clock);
+  printf("clock: %lu switches, %lu us max, 8/32/48MHz %lu/%lu/%lu ms, ~%lu uA\r\n",
+         clock.switches, clock.max_switch_us, clock.residency_ms[CLOCK_IDLE],
+         clock.residency_ms[CLOCK_NORMAL], clock.residency_ms[CLOCK_FAST],
+         clock.estimated_ua);
+#endif
+}
+#endif
+
+#ifdef CPU_TIME
+/* Any byte received on the UART asks for a report. The receiver is
+   polled, USART2 has no interrupt enabled; in Stop mode the byte is
+   lost, press the button first. */
+static void cpu_time_run(void)
+{
+  if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_ORE))
+  {
+    __HAL_UART_CLEAR_OREFLAG(&huart2);
+  }
+  if (__HAL_UART_GET_FLAG(&huart2, UART_FLAG_RXNE))
+  {
+    __HAL_UART_SEND_REQ(&huart2, UART_RXDATA_FLUSH_REQUEST);
+    cpu_time_report();
+  }
+}
+#endif
+
+#ifdef MIDEA_IR_ISR_LATENCY
+/* One line per frame: tick count, worst latency, late and missed ticks,
+   then the ticks of each latency bucket, 0, 1, 2-3, 4-7... cycles. */
+static void latency_run(void)
+{
+  MideaIRLatency latency;
+
+  midea_ir_latency(&latency);
+  if (!latency.ticks)
+  { // registration run, or the DMA engine
+    return;
+  }
+  printf("IR latency: %u ticks, %u cycles max, %u late, %u missed |",
+         latency.ticks, latency.max_latency, latency.late, latency.missed);
+  for (uint8_t i = 0; i < MIDEA_IR_LATENCY_BUCKETS; i++)
+  {
+    printf(" %u", latency.histogram[i]);
+  }
+  printf("\r\n");
+}
+#endif
+
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+  if (GPIO_Pin == SW_Pin)
+  {
+    button_edge();
+  }
+}
+
+/* Nothing can happen in Stop mode but a button press, so it is only
+   entered once the remote has been left alone for a while and nothing
+   is on the way out. Otherwise sleep until the next interrupt, SysTick
+   included, so the tasks keep their timing. */
+static bool stop_allowed(void)
+{
+  return HAL_GetTick() - last_input >= STOP_IDLE_DELAY &&
+         !button_pressed() &&
+         !midea_ir_busy() &&
+         spi_bus_idle() &&
+         __HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC);
+}
+
+/* Called with interrupts disabled, the EXTI handler runs only once the
+   clock is restored. */
+void scheduler_idle(void)
+{
+  if (!stop_allowed())
+  {
+    __WFI();
+    return;
+  }
+
+  DisplaySuspend(); // dark in Stop if it was dimmed, see display.h
+  knob_suspend();   // the ADC would stay enabled without a clock
+  HAL_SuspendTick();
+  HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+#ifdef SCHEDULER_REPORT
+  uint32_t wake_val = SysTick->VAL; // SysTick runs from HSI until the clock is back
+  uint32_t clock_val = SystemClock_Restore();
+#else
+  SystemClock_Restore();
+#endif
+  knob_resume();
+  HAL_ResumeTick();
+  DisplayFlush();
+#ifdef SCHEDULER_REPORT
+  uint32_t load = SysTick->LOAD + 1;
+  uint32_t cycles_hsi = (wake_val - clock_val + load) % load;
+  uint32_t cycles_clock = (clock_val - SysTick->VAL + load) % load;
+  wake_restore_us = cycles_hsi / (HSI_VALUE / 1000000) +
+                    cycles_clock / (SystemCoreClock / 1000000);
+  wake_stamp = scheduler_cycles();
+  wake_pending = true;
+#endif
+}
+
+/* Stop mode leaves HSI as the system clock and turns the PLL and HSI14
+   off. Their configuration is kept, so restart them directly instead of
+   going through SystemClock_Config, which also waits on all the HAL
+   timeouts. Returns SysTick->VAL once the system clock is back. */
+static uint32_t SystemClock_Restore(void)
+{
+#ifdef CLOCK_SCALING
+  return clock_resume();
+#else
+  RCC->CR2 |= RCC_CR2_HSI14ON;
+  RCC->CR |= RCC_CR_PLLON;
+  while (!(RCC->CR & RCC_CR_PLLRDY))
+  {
+  }
+  RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+  while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)
+  {
+  }
+  uint32_t back = SysTick->VAL;
+  while (!(RCC->CR2 & RCC_CR2_HSI14RDY))
+  {
+  }
+  return back;
+#endif
+}
+
+int __io_putchar(int ch)
+{
+#ifdef CPU_TIME
+  CpuTimer timer;
+  cpu_time_start(&timer);
+#endif
+  HAL_UART_Transmit(&huart2, (uint8_t *)&ch, 1, 0xFFFF);
+#ifdef CPU_TIME
+  cpu_time_stop(&timer, CPU_UART_WAIT);
+#endif
+  return ch;
+}
+/* USER CODE END 4 */
+
+/**
+ * @brief  This function is executed in case of error occurrence.
+ * @retval None
+ */
+void Error_Handler(void)
+{
+  /* USER CODE BEGIN Error_Handler_Debug */
+  /* User can add his own implementation to report the HAL error return state */
+  __disable_irq();
+  while (1)
+  {
+  }
+  /* USER CODE END Error_Handler_Debug */
+}
+
+#ifdef USE_FULL_ASSERT
+/**
+ * @brief  Reports the name of the source file and the source line number
+ *         where the assert_param error has occurred.
+ * @param  file: pointer to the source file name
+ * @param  line: assert_param error line source number
+ * @retval None
+ */
+void assert_failed(uint8_t *file, uint32_t line)
+{
+  /* USER CODE BEGIN 6 */
+  /* User can add his own implementation to report the file name and line number,
+     ex: printf("Wrong parameters value: file %s on line %d\r\n", file, line) */
+  /* USER CODE END 6 */
+}
+#endif /* USE_FULL_ASSERT */
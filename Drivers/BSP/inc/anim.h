@@ -0,0 +1,54 @@
+#ifndef __ANIM_H__
+#define __ANIM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Display animations, played on the display overlay by a scheduler task.
+ *
+ * An animation is a short description kept in flash, the frames are
+ * computed step by step, so nothing waits and a text costs its
+ * characters only. The framebuffer keeps being written underneath and
+ * is shown again when the animation ends.
+ */
+typedef enum {
+    ANIM_SCROLL, // text enters on the right and leaves on the left
+    ANIM_BLINK,  // the first two characters of text, on and off
+    ANIM_FRAMES, // raw segments, two bytes (tens, ones) per frame
+} AnimKind;
+
+typedef struct {
+    AnimKind kind;
+    union {
+        const char *text;
+        const uint8_t *frames;
+    };
+    uint8_t length; // frames of ANIM_FRAMES, ignored for text
+    uint16_t step;  // ms per frame
+    uint8_t loops;  // times played, 0 until anim_stop()
+} Anim;
+
+/**
+ * Segments chasing around both digits, for IR transmission.
+ */
+extern const Anim anim_spinner;
+
+/**
+ * Start playing the animation, it replaces the one playing. The
+ * animation and its text must outlive the playback. Only call it from
+ * tasks or before scheduler_run().
+ */
+void anim_play(const Anim *anim);
+
+/**
+ * Stop the animation playing and show the framebuffer.
+ */
+void anim_stop(void);
+
+/**
+ * The animation playing, NULL when none.
+ */
+const Anim *anim_playing(void);
+
+#endif /* __ANIM_H__ */
@@ -0,0 +1,41 @@
+#ifndef __BUTTON_H__
+#define __BUTTON_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scheduler.h"
+
+#define BUTTON_DEBOUNCE_MS      20  // an accepted edge masks further edges
+#define BUTTON_LONG_PRESS_MS    800 // held before BUTTON_LONG_PRESS
+#define BUTTON_DOUBLE_WINDOW_MS 300 // from a release to a press for BUTTON_DOUBLE_PRESS
+
+typedef enum {
+    BUTTON_PRESS,
+    BUTTON_RELEASE,
+    BUTTON_LONG_PRESS,   // still held after BUTTON_LONG_PRESS_MS
+    BUTTON_DOUBLE_PRESS, // follows the BUTTON_PRESS of the second press
+} ButtonEvent;
+
+/**
+ * Initialize the button input of SW (PB1, active low) with its current
+ * level. The consumer task is posted whenever an event is queued.
+ */
+void button_init(SchedulerTask *consumer);
+
+/**
+ * Call from the EXTI callback of SW, on both edges.
+ */
+void button_edge(void);
+
+/**
+ * Take the oldest event, returns false if there is none.
+ */
+bool button_get_event(ButtonEvent *event);
+
+/**
+ * Debounced level of the button.
+ */
+bool button_pressed(void);
+
+#endif /* __BUTTON_H__ */
@@ -0,0 +1,55 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * System clock profiles.
+ *
+ * CLOCK_IDLE   - HSI, 8MHz, no PLL, zero flash wait state
+ * CLOCK_NORMAL - HSI x 4, 32MHz, the one set by SystemClock_Config
+ * CLOCK_FAST   - HSI/2 x 12, 48MHz
+ */
+typedef enum {
+    CLOCK_IDLE,
+    CLOCK_NORMAL,
+    CLOCK_FAST,
+    CLOCK_PROFILES
+} ClockProfile;
+
+typedef struct {
+    uint32_t switches;
+    uint32_t max_switch_us;                 // longest switch, PLL lock included
+    uint32_t residency_ms[CLOCK_PROFILES];  // time spent in each profile
+    uint32_t estimated_ua;                  // average run current of the residency
+} ClockStats;
+
+/**
+ * Take over after SystemClock_Config and the timer setup, in CLOCK_NORMAL.
+ */
+void clock_init(void);
+
+/**
+ * Switch the system clock and retune TIM1, SPI1, USART2 and SysTick to
+ * keep their rates. The IR transmitter must be idle, the pending UART
+ * byte is waited for.
+ */
+void clock_set(ClockProfile profile);
+
+ClockProfile clock_get(void);
+
+/**
+ * Bring the current profile back after Stop mode, which leaves HSI
+ * running. Call with interrupts disabled, right after the wake up.
+ * Returns SysTick->VAL once the profile clock runs, SysTick counts HSI
+ * cycles until then.
+ */
+uint32_t clock_resume(void);
+
+/**
+ * Read and reset the statistics.
+ */
+void clock_stats(ClockStats *stats);
+
+#endif /* __CLOCK_H__ */
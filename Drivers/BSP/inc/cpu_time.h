@@ -0,0 +1,43 @@
+#ifndef __CPU_TIME_H__
+#define __CPU_TIME_H__
+
+#include <stdint.h>
+
+/**
+ * CPU time accounting, built with CPU_TIME.
+ *
+ * Every core cycle goes to one state. Waits are timed in thread mode
+ * between cpu_time_start() and cpu_time_stop(), the IR interrupts are
+ * timed by midea_ir itself and taken out of the wait they interrupted.
+ * What is left is CPU_RUN, the tasks doing actual work.
+ */
+typedef enum {
+    CPU_RUN,       // tasks, and interrupts other than IR
+    CPU_IDLE,      // scheduler sleeping, Stop mode excluded
+    CPU_IR,        // IR transmit interrupts
+    CPU_SPI_WAIT,  // clock switch waiting for the SPI bus to drain
+    CPU_UART_WAIT, // blocking printf output
+    CPU_DELAY,     // HAL_Delay
+    CPU_STATES
+} CpuState;
+
+typedef struct {
+    uint32_t cycles;    // scheduler_cycles() at the start
+    uint32_t ir_cycles; // IR interrupt cycles at the start
+} CpuTimer;
+
+void cpu_time_start(CpuTimer *timer);
+
+/**
+ * Account the time since cpu_time_start() to the state, less the IR
+ * interrupts taken meanwhile. Only call it from thread mode.
+ */
+void cpu_time_stop(CpuTimer *timer, CpuState state);
+
+/**
+ * Print the share of each state since the previous report and start a
+ * new period.
+ */
+void cpu_time_report(void);
+
+#endif /* __CPU_TIME_H__ */
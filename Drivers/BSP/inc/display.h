@@ -9,9 +9,58 @@
 #define BSP_INC_DISPLAY_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
+/*
+ * None of these wait for the display, the word is sent by DMA and only
+ * if it changed.
+ */
 void DisplayDecimal(uint8_t value);
 void DisplayHex(uint8_t value);
 void DisplayOff(void);
 
+/*
+ * Framebuffer access: digit 0 is the tens digit, segments has bit 0..6
+ * for segment a..g and bit 7 for the dot, set for a lit segment. Call
+ * DisplayFlush() to show the framebuffer.
+ */
+void DisplaySetSegments(uint8_t digit, uint8_t segments);
+void DisplayFlush(void);
+
+/*
+ * Overlay: segments shown in place of the framebuffer, which keeps being
+ * updated underneath and comes back with DisplayOverlayOff().
+ */
+void DisplayOverlay(uint8_t tens, uint8_t ones);
+void DisplayOverlayOff(void);
+
+/*
+ * Segments of a character, digits and the letters that can be drawn on
+ * seven segments, 0 for the others.
+ */
+uint8_t DisplayGlyph(char c);
+
+/*
+ * Brightness, 0 (blank) to DISPLAY_LEVELS (full). Below full the display
+ * is refreshed by TIM16 and DMA, without CPU.
+ */
+#define DISPLAY_LEVELS 16
+
+void DisplaySetBrightness(uint8_t level);
+uint8_t DisplayGetBrightness(void);
+
+/*
+ * Stop the brightness PWM and blank the display, e.g. before Stop mode
+ * where the PWM cannot run. Waits for the blank word to be latched, at
+ * most two words, so only call it with the SPI bus idle. DisplayFlush()
+ * starts the PWM again.
+ *
+ * A dimmed display is dark for as long as the PWM is stopped. The only
+ * word the shift registers can hold on their own is at full brightness,
+ * and an idle display that lights up again defeats the dimming, so blank
+ * is the lesser of the two. At full brightness nothing is running and
+ * the display keeps its word.
+ */
+void DisplaySuspend(void);
+
 #endif /* BSP_INC_DISPLAY_H_ */
@@ -0,0 +1,46 @@
+#ifndef __KNOB_H__
+#define __KNOB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef KNOB_AWD
+#include "scheduler.h"
+#endif
+
+#define KNOB_OFF 0 // knob_temperature() turned past TEMP_HIGH
+
+/**
+ * Start sampling the POT knob. The ADC converts continuously into a
+ * circular DMA buffer, reading the knob never waits for a conversion.
+ */
+void knob_init(void);
+
+/**
+ * Stop the conversions before Stop mode, where the ADC has no clock, and
+ * start them again after the clock is restored. Until the DMA has
+ * refilled the buffer, ~2ms, the average still holds samples from before.
+ */
+void knob_suspend(void);
+void knob_resume(void);
+
+/**
+ * Average of the last conversions, 12 bit.
+ */
+uint16_t knob_value(void);
+
+/**
+ * Knob position as temperature, TEMP_LOW..TEMP_HIGH, or KNOB_OFF.
+ */
+uint8_t knob_temperature(void);
+
+#ifdef KNOB_AWD
+/**
+ * Post the task whenever the knob leaves its current position, instead
+ * of reading the knob periodically. The watch is armed again by every
+ * knob_temperature() call.
+ */
+void knob_watch(SchedulerTask *task);
+#endif
+
+#endif /* __KNOB_H__ */
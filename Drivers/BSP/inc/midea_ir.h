@@ -7,6 +7,25 @@
 #define TEMP_LOW  17
 #define TEMP_HIGH 30
 
+/**
+ * Transmit engines, select one with -DMIDEA_IR_TX_ENGINE=...
+ *
+ * MIDEA_IR_TX_ISR - TIM1 update interrupt drives the LED on every carrier
+ *                   half-period (default)
+ * MIDEA_IR_TX_DMA - TIM1 update events trigger DMA writes of precomputed
+ *                   GPIOA->BSRR words, the CPU only refills the buffer
+ * MIDEA_IR_TX_PWM - TIM1 channel 3 generates the carrier, the CPU is only
+ *                   interrupted on pulse boundaries. Needs the IR LED
+ *                   reworked to PA10 (BOARD_IR_LED_PA10, see main.h)
+ */
+#define MIDEA_IR_TX_ISR 0
+#define MIDEA_IR_TX_DMA 1
+#define MIDEA_IR_TX_PWM 2
+
+#ifndef MIDEA_IR_TX_ENGINE
+#define MIDEA_IR_TX_ENGINE MIDEA_IR_TX_ISR
+#endif
+
 typedef enum {
     MODE_COOL       = 0b0000,
     MODE_HEAT       = 0b1100,
@@ -17,7 +36,7 @@ typedef enum {
 
 typedef struct MideaIR {
     uint8_t temperature; // in Celsius
-    uint8_t fan_level;   // 0..3
+    uint8_t fan_level;   // 0..3, sent as 0 when out of range
     MideaMode mode;
     bool enabled;        // on/off air conditioner
 } MideaIR;
@@ -28,13 +47,66 @@ typedef struct MideaIR {
 void midea_ir_init(MideaIR *ir);
 
 /**
- * Send Ir signal to air conditioner
+ * Queue Ir signal to air conditioner, replaces a state that is still
+ * waiting to be sent. Built with MIDEA_IR_PREEMPT it also cuts short the
+ * state frame being sent. False if the queue is full of deflector moves,
+ * nothing is sent then.
+ */
+bool midea_ir_send(MideaIR *ir);
+
+/**
+ * Queue Ir signal to move deflector, false if the queue is full
+ */
+bool midea_ir_move_deflector(MideaIR *ir);
+
+/**
+ * True while a frame is being sent or waiting to be sent
+ */
+bool midea_ir_busy(void);
+
+/**
+ * Called from interrupt context when a frame (with its repeats) is sent,
+ * override to get notified
+ */
+void midea_ir_sent_callback(void);
+
+#ifdef MIDEA_IR_ISR_BENCH
+typedef struct {
+    uint16_t max_cycles; // worst case cycles spent in midea_ir_irq_handler
+    uint16_t max_exit;   // worst case cycles from update event to handler exit
+    uint16_t budget;     // cycles between two update events
+} MideaIRBench;
+
+/**
+ * Read and reset the worst case cycle counts of the TIM1 interrupt
+ */
+void midea_ir_bench(MideaIRBench *bench);
+#endif
+
+#ifdef MIDEA_IR_ISR_LATENCY
+#define MIDEA_IR_LATENCY_BUCKETS 11 // 0, 1, 2-3, 4-7 ... 512 and more cycles
+
+typedef struct {
+    uint16_t histogram[MIDEA_IR_LATENCY_BUCKETS]; // ticks by entry latency
+    uint16_t max_latency; // cycles from update event to handler entry
+    uint16_t late;        // ticks entered more than a quarter tick late
+    uint16_t missed;      // ticks whose handler ran into the next update
+    uint16_t ticks;
+} MideaIRLatency;
+
+/**
+ * Entry latency of the TIM1 interrupt over the last frame sent (with its
+ * repeats), read it from midea_ir_sent_callback() on. Not available with
+ * the DMA engine, which takes no interrupt per tick.
  */
-void midea_ir_send(MideaIR *ir);
+void midea_ir_latency(MideaIRLatency *latency);
+#endif
 
+#ifdef CPU_TIME
 /**
- * Send Ir signal to move deflector
+ * Core cycles spent in the transmit interrupts, wraps around
  */
-void midea_ir_move_deflector(MideaIR *ir);
+uint32_t midea_ir_isr_cycles(void);
+#endif
 
 #endif  // __MIDEA_IR_H__
\ No newline at end of file
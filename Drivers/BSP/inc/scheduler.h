@@ -0,0 +1,85 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Cooperative scheduler.
+ *
+ * Tasks run to completion one after the other from scheduler_run(), in
+ * thread mode, so they never preempt each other and need no locking
+ * between them. Timing is based on the 1ms HAL tick. When nothing is
+ * due the scheduler calls scheduler_idle(), which sleeps until the next
+ * interrupt by default. With SCHEDULER_TICKLESS the tick interrupt is
+ * held off until the nearest deadline while sleeping (tickless.h).
+ *
+ * Tasks are statically allocated, e.g.:
+ *
+ *   static SchedulerTask knob_task = SCHEDULER_TASK("knob", knob_run, 20);
+ *   scheduler_add(&knob_task, 0);
+ */
+typedef struct SchedulerTask {
+    const char *name;
+    void (*run)(void);
+    uint32_t period; // ms between two runs, 0 for a one-shot task
+
+    struct SchedulerTask *next;
+    uint32_t due;         // HAL tick of the next run
+    bool armed;           // waits for its due time
+    volatile bool posted; // run as soon as possible
+
+    uint32_t runs;
+    uint32_t max_cycles; // longest run in core clock cycles
+    uint32_t overruns;   // runs started more than a period late
+} SchedulerTask;
+
+#define SCHEDULER_TASK(task_name, task_run, period_ms) \
+    { .name = (task_name), .run = (task_run), .period = (period_ms) }
+
+/**
+ * Register the task if needed and arm it to run after delay ms, then
+ * every period ms. Only call it from tasks or before scheduler_run().
+ */
+void scheduler_add(SchedulerTask *task, uint32_t delay);
+
+/**
+ * Run the task as soon as possible, once. Safe to call from interrupts.
+ */
+void scheduler_post(SchedulerTask *task);
+
+/**
+ * Disarm the task, a posted run is dropped too.
+ */
+void scheduler_cancel(SchedulerTask *task);
+
+/**
+ * Disarm the task, a run posted meanwhile still happens: for a task
+ * posted from an interrupt that disarms itself.
+ */
+void scheduler_disarm(SchedulerTask *task);
+
+/**
+ * Run the tasks, never returns.
+ */
+void scheduler_run(void);
+
+/**
+ * Called with interrupts disabled when no task is ready. Must return
+ * once an interrupt is pending. Default implementation is __WFI().
+ */
+void scheduler_idle(void);
+
+/**
+ * Core clock cycles, taken from the HAL tick and the SysTick counter so
+ * no extra timer is needed. Wraps around, only differences are valid.
+ */
+uint32_t scheduler_cycles(void);
+
+/**
+ * Print the run count, longest run time and overruns of every task, and
+ * reset the run time statistics.
+ */
+void scheduler_report(void);
+
+#endif /* __SCHEDULER_H__ */
@@ -0,0 +1,79 @@
+#ifndef __SPI_BUS_H__
+#define __SPI_BUS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "main.h"
+
+/**
+ * SPI1 shared between devices.
+ *
+ * Transfers are queued and sent by DMA one after the other, the DMA
+ * completion of one starts the next, so no caller waits for the bus.
+ * SPI1 is set up for the device of each transfer: data size, chip
+ * select and a prescaler derived from the device's highest clock and
+ * the current core clock, which keeps the devices in spec under
+ * CLOCK_SCALING.
+ *
+ * The bus is transmit only: MISO (PA6) is the knob input.
+ *
+ * Devices on hardware NSS share DISP_LAT (PA4), pulsed after every
+ * frame. While a device with its own GPIO chip select is addressed,
+ * DISP_LAT is held high as a GPIO, so the display does not latch the
+ * bits shifted through it.
+ */
+typedef struct {
+    GPIO_TypeDef *cs_port; // NULL for hardware NSS
+    uint16_t cs_pin;       // active low
+    uint32_t data_size;    // SPI_DATASIZE_8BIT or SPI_DATASIZE_16BIT
+    uint32_t max_hz;       // fastest SCK the device takes
+} SpiDevice;
+
+typedef struct SpiTransfer {
+    const SpiDevice *device;
+    const void *data;  // must stay unchanged until done
+    uint16_t count;    // frames of the device data size
+    void (*done)(struct SpiTransfer *transfer); // interrupt context, can submit again
+
+    struct SpiTransfer *next;
+    volatile bool queued; // waits or is on the wire
+} SpiTransfer;
+
+/**
+ * A device writing the data register by itself, the display brightness
+ * PWM for one. It gets the bus whenever no transfer is queued: stop()
+ * is called when a transfer is submitted, start() again once the queue
+ * is empty, with SPI1 set up for the device. Both can be called from
+ * interrupts.
+ */
+typedef struct {
+    const SpiDevice *device;
+    void (*start)(void);
+    void (*stop)(void);
+} SpiStream;
+
+/**
+ * Queue the transfer, returns false if it is still queued. Safe to call
+ * from interrupts.
+ */
+bool spi_bus_submit(SpiTransfer *transfer);
+
+/**
+ * Set the stream, NULL to end it. The running stream is stopped and
+ * the bus waits for its last frame.
+ */
+void spi_bus_stream(const SpiStream *stream);
+
+/**
+ * True when no transfer is queued or on the wire, a stream aside.
+ */
+bool spi_bus_idle(void);
+
+/**
+ * Derive the prescaler again after a change of SystemCoreClock. Call
+ * with interrupts disabled and the bus idle.
+ */
+void spi_bus_clock_changed(void);
+
+#endif /* __SPI_BUS_H__ */
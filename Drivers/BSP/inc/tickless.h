@@ -0,0 +1,27 @@
+#ifndef __TICKLESS_H__
+#define __TICKLESS_H__
+
+#include <stdint.h>
+
+/**
+ * Tickless HAL timebase, built with SCHEDULER_TICKLESS.
+ *
+ * Replaces HAL_InitTick, HAL_IncTick and HAL_GetTick. SysTick keeps its
+ * 1ms period while tasks run; before sleeping the scheduler stretches
+ * the period up to its next deadline, so an idle board takes one SysTick
+ * interrupt instead of one every millisecond. HAL_GetTick stays correct
+ * at any time, including in the middle of a stretched period.
+ */
+
+/**
+ * Make the SysTick interrupt come no later than sleep_ms after the
+ * current tick. Call with interrupts disabled, right before sleeping.
+ */
+void tickless_prepare(uint32_t sleep_ms);
+
+/**
+ * Core clock cycles, see scheduler_cycles().
+ */
+uint32_t tickless_cycles(void);
+
+#endif /* __TICKLESS_H__ */
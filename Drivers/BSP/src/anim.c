@@ -0,0 +1,108 @@
+#include "anim.h"
+#include "display.h"
+#include "scheduler.h"
+#include <string.h>
+
+// segments: a 0x01, b 0x02, c 0x04, d 0x08, e 0x10, f 0x20, g 0x40
+static const uint8_t spinner_frames[] = {
+    0x01, 0x00,
+    0x00, 0x01,
+    0x00, 0x02,
+    0x00, 0x04,
+    0x00, 0x08,
+    0x08, 0x00,
+    0x10, 0x00,
+    0x20, 0x00,
+};
+
+const Anim anim_spinner = {
+    .kind = ANIM_FRAMES,
+    .frames = spinner_frames,
+    .length = sizeof(spinner_frames) / 2,
+    .step = 60,
+    .loops = 0,
+};
+
+static void anim_run(void);
+
+static SchedulerTask anim_task = SCHEDULER_TASK("anim", anim_run, 0);
+static const Anim *anim;
+static uint8_t length; // frames in a loop
+static uint8_t frame;  // next frame
+static uint8_t loops;  // loops left, 0 for endless
+
+static uint8_t text_glyph(int16_t i)
+{
+    return i >= 0 && i < (int16_t)strlen(anim->text) ? DisplayGlyph(anim->text[i]) : 0;
+}
+
+static void anim_run(void)
+{
+    if (!anim)
+    {
+        return;
+    }
+    if (frame == length)
+    {
+        if (loops && !--loops)
+        {
+            anim_stop();
+            return;
+        }
+        frame = 0;
+    }
+
+    switch (anim->kind)
+    {
+    case ANIM_SCROLL:
+        DisplayOverlay(text_glyph(frame - 1), text_glyph(frame));
+        break;
+    case ANIM_BLINK:
+        if (frame == 0)
+        {
+            DisplayOverlay(text_glyph(0), text_glyph(1));
+        }
+        else
+        {
+            DisplayOverlay(0, 0);
+        }
+        break;
+    case ANIM_FRAMES:
+        DisplayOverlay(anim->frames[2 * frame], anim->frames[2 * frame + 1]);
+        break;
+    }
+    frame++;
+    scheduler_add(&anim_task, anim->step);
+}
+
+void anim_play(const Anim *next)
+{
+    anim = next;
+    frame = 0;
+    loops = next->loops;
+    switch (next->kind)
+    {
+    case ANIM_SCROLL:
+        length = strlen(next->text) + 2; // until the last character left both digits
+        break;
+    case ANIM_BLINK:
+        length = 2;
+        break;
+    case ANIM_FRAMES:
+        length = next->length;
+        break;
+    }
+    anim_run();
+}
+
+void anim_stop(void)
+{
+    anim = NULL;
+    scheduler_cancel(&anim_task);
+    DisplayOverlayOff();
+}
+
+const Anim *anim_playing(void)
+{
+    return anim;
+}
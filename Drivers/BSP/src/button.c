@@ -0,0 +1,142 @@
+#include "button.h"
+#include "main.h"
+
+/**
+ * Debounce.
+ *
+ * Edges are accepted as soon as they arrive, the EXTI interrupt only
+ * posts the button task, so an event is queued within the time it takes
+ * the scheduler to get to it. After an accepted edge the level is left
+ * alone for BUTTON_DEBOUNCE_MS, the bounces of the contact are ignored,
+ * then the level is checked once more: a change that happened while
+ * masked is accepted then.
+ *
+ * The same one-shot task also times the long press, its deadline is
+ * always the nearest of the two.
+ */
+
+#define EVENT_QUEUE_SIZE 8
+
+static void button_run(void);
+
+static SchedulerTask button_task = SCHEDULER_TASK("button", button_run, 0);
+static SchedulerTask *event_consumer;
+
+static ButtonEvent event_queue[EVENT_QUEUE_SIZE];
+static uint8_t event_head;  // oldest event
+static uint8_t event_count; // queued events
+
+static bool pressed;          // debounced level
+static uint32_t edge_time;    // HAL tick of the last accepted edge
+static uint32_t release_time; // HAL tick of the last accepted release
+static bool long_pending;     // long press not reported yet for this press
+
+static inline bool read_pressed(void)
+{
+    return HAL_GPIO_ReadPin(SW_GPIO_Port, SW_Pin) == GPIO_PIN_RESET;
+}
+
+static void emit(ButtonEvent event)
+{
+    if (event_count == EVENT_QUEUE_SIZE)
+    { // consumer is behind, drop the oldest event
+        event_head = (event_head + 1) % EVENT_QUEUE_SIZE;
+        event_count--;
+    }
+    event_queue[(event_head + event_count) % EVENT_QUEUE_SIZE] = event;
+    event_count++;
+
+    if (event_consumer)
+    {
+        scheduler_post(event_consumer);
+    }
+}
+
+static void accept_edge(uint32_t now)
+{
+    bool double_press = !pressed && now - release_time < BUTTON_DOUBLE_WINDOW_MS;
+
+    pressed = !pressed;
+    edge_time = now;
+
+    if (pressed)
+    {
+        long_pending = true;
+        emit(BUTTON_PRESS);
+        if (double_press)
+        {
+            emit(BUTTON_DOUBLE_PRESS);
+            release_time = now - BUTTON_DOUBLE_WINDOW_MS; // a third press is a new one
+        }
+    }
+    else
+    {
+        long_pending = false;
+        release_time = now;
+        emit(BUTTON_RELEASE);
+    }
+}
+
+static void button_run(void)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t since_edge = now - edge_time;
+
+    if (since_edge >= BUTTON_DEBOUNCE_MS && read_pressed() != pressed)
+    {
+        accept_edge(now);
+        since_edge = 0;
+    }
+
+    if (long_pending && since_edge >= BUTTON_LONG_PRESS_MS)
+    {
+        long_pending = false;
+        emit(BUTTON_LONG_PRESS);
+    }
+
+    // next deadline: end of the debounce mask, then the long press
+    if (since_edge < BUTTON_DEBOUNCE_MS)
+    {
+        scheduler_add(&button_task, BUTTON_DEBOUNCE_MS - since_edge);
+    }
+    else if (long_pending)
+    {
+        scheduler_add(&button_task, BUTTON_LONG_PRESS_MS - since_edge);
+    }
+    else
+    { // an edge posted during this run must still get its run
+        scheduler_disarm(&button_task);
+    }
+}
+
+void button_init(SchedulerTask *consumer)
+{
+    event_consumer = consumer;
+    pressed = read_pressed();
+    edge_time = HAL_GetTick() - BUTTON_DEBOUNCE_MS;
+    release_time = edge_time - BUTTON_DOUBLE_WINDOW_MS;
+    scheduler_add(&button_task, 0);
+}
+
+void button_edge(void)
+{
+    scheduler_post(&button_task);
+}
+
+bool button_get_event(ButtonEvent *event)
+{
+    if (!event_count)
+    {
+        return false;
+    }
+
+    *event = event_queue[event_head];
+    event_head = (event_head + 1) % EVENT_QUEUE_SIZE;
+    event_count--;
+    return true;
+}
+
+bool button_pressed(void)
+{
+    return pressed;
+}
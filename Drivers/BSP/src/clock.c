@@ -0,0 +1,217 @@
+#include "clock.h"
+#include "main.h"
+#include "tim.h"
+#include "spi_bus.h"
+#include "usart.h"
+#ifdef CPU_TIME
+#include "cpu_time.h"
+#endif
+
+/**
+ * The switch is done on the registers: going through HAL_RCC_OscConfig
+ * and HAL_RCC_ClockConfig costs their timeout bookkeeping on every
+ * switch. The PLL can only be reconfigured while it is off, so a switch
+ * between two PLL profiles runs from HSI while the PLL locks again.
+ *
+ * Everything clocked from PCLK is retuned for the new frequency:
+ * - TIM1 keeps its ~76kHz update, twice the IR carrier: its CubeMX
+ *   period is scaled from the boot clock, so switching back restores it
+ * - TIM16 keeps its 1MHz count, the display brightness PWM
+ * - SPI1 keeps every device at or below its clock (spi_bus.h)
+ * - USART2 keeps its baud rate
+ * - SysTick keeps its 1ms period (HAL_InitTick)
+ * The ADC runs from PCLK/4, its sample rate follows the clock, which
+ * the knob average does not mind.
+ *
+ * The current estimate weights typical run currents from the datasheet
+ * (code from flash, peripherals enabled) with the time spent in each
+ * profile. It ignores sleep, so it is an upper bound. The figures can
+ * be overridden with -DCLOCK_IDD_*_UA for a measured board.
+ */
+
+#define PWM_TICK_RATE 1000000 // TIM16 counts per second
+
+#ifndef CLOCK_IDD_IDLE_UA
+#define CLOCK_IDD_IDLE_UA 4400
+#endif
+#ifndef CLOCK_IDD_NORMAL_UA
+#define CLOCK_IDD_NORMAL_UA 15100
+#endif
+#ifndef CLOCK_IDD_FAST_UA
+#define CLOCK_IDD_FAST_UA 22000
+#endif
+
+typedef struct
+{
+    uint32_t hz;
+    uint32_t pllmul; // RCC_CFGR PLLMUL bits, 0 for HSI without PLL
+    uint32_t prediv; // RCC_CFGR2 PREDIV bits
+    uint32_t idd_ua; // typical run current
+} ProfileConfig;
+
+static const ProfileConfig profiles[CLOCK_PROFILES] = {
+    [CLOCK_IDLE] = {8000000, 0, 0, CLOCK_IDD_IDLE_UA},
+    [CLOCK_NORMAL] = {32000000, RCC_CFGR_PLLMUL4, RCC_CFGR2_PREDIV_DIV1, CLOCK_IDD_NORMAL_UA},
+    [CLOCK_FAST] = {48000000, RCC_CFGR_PLLMUL12, RCC_CFGR2_PREDIV_DIV2, CLOCK_IDD_FAST_UA},
+};
+
+static ClockProfile profile;
+static uint32_t profile_since; // HAL tick of the last switch
+static ClockStats stats;
+static uint32_t boot_hz;        // SystemCoreClock of the CubeMX setup
+static uint32_t boot_ir_cycles; // TIM1 update period at boot_hz
+
+static void switch_to_hsi(void)
+{
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_HSI;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI)
+    {
+    }
+}
+
+static void switch_to_pll(void)
+{
+    RCC->CR |= RCC_CR_PLLON;
+    while (!(RCC->CR & RCC_CR_PLLRDY))
+    {
+    }
+    FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | FLASH_ACR_LATENCY;
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+    while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)
+    {
+    }
+}
+
+static void retune_peripherals(uint32_t hz)
+{
+    htim1.Init.Period = ((uint64_t)boot_ir_cycles * hz + boot_hz / 2) / boot_hz - 1;
+    __HAL_TIM_SET_AUTORELOAD(&htim1, htim1.Init.Period);
+
+    htim16.Init.Prescaler = hz / PWM_TICK_RATE - 1;
+    __HAL_TIM_SET_PRESCALER(&htim16, htim16.Init.Prescaler);
+
+    while (!__HAL_UART_GET_FLAG(&huart2, UART_FLAG_TC))
+    {
+    }
+    __HAL_UART_DISABLE(&huart2);
+    huart2.Instance->BRR = UART_DIV_SAMPLING16(hz, huart2.Init.BaudRate);
+    __HAL_UART_ENABLE(&huart2);
+
+    SystemCoreClock = hz;
+    spi_bus_clock_changed();
+    HAL_InitTick(uwTickPrio);
+}
+
+static void account(uint32_t now)
+{
+    stats.residency_ms[profile] += now - profile_since;
+    profile_since = now;
+}
+
+void clock_init(void)
+{
+    profile = CLOCK_NORMAL;
+    profile_since = HAL_GetTick();
+    boot_hz = SystemCoreClock;
+    boot_ir_cycles = htim1.Init.Period + 1;
+}
+
+void clock_set(ClockProfile next)
+{
+    const ProfileConfig *config = &profiles[next];
+
+    if (next == profile)
+    {
+        return;
+    }
+    account(HAL_GetTick());
+#ifdef CPU_TIME
+    CpuTimer timer;
+    cpu_time_start(&timer);
+#endif
+    for (;;)
+    { // transfers on the way end in their DMA interrupt
+        __disable_irq();
+        if (spi_bus_idle())
+        {
+            break;
+        }
+        __enable_irq();
+    }
+#ifdef CPU_TIME
+    cpu_time_stop(&timer, CPU_SPI_WAIT);
+#endif
+    uint32_t load = SysTick->LOAD + 1;
+    uint32_t start = SysTick->VAL;
+
+    switch_to_hsi();
+    // SysTick counts HSI cycles from here until the new clock is set
+    uint32_t hsi_start = SysTick->VAL;
+    RCC->CR &= ~RCC_CR_PLLON;
+    if (config->pllmul)
+    {
+        while (RCC->CR & RCC_CR_PLLRDY)
+        {
+        }
+        RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_PLLMUL | RCC_CFGR_PLLSRC)) |
+                    config->pllmul | RCC_CFGR_PLLSRC_HSI_PREDIV;
+        RCC->CFGR2 = (RCC->CFGR2 & ~RCC_CFGR2_PREDIV) | config->prediv;
+        switch_to_pll();
+    }
+    else
+    {
+        FLASH->ACR &= ~FLASH_ACR_LATENCY;
+    }
+    uint32_t hsi_end = SysTick->VAL;
+
+    uint32_t old_mhz = SystemCoreClock / 1000000;
+    uint32_t cycles_old = (start - hsi_start + load) % load;
+    uint32_t cycles_hsi = (hsi_start - hsi_end + load) % load;
+
+    retune_peripherals(config->hz);
+    profile = next;
+    __enable_irq();
+
+    uint32_t us = cycles_old / old_mhz + cycles_hsi / (HSI_VALUE / 1000000);
+    stats.switches++;
+    if (us > stats.max_switch_us)
+    {
+        stats.max_switch_us = us;
+    }
+}
+
+ClockProfile clock_get(void)
+{
+    return profile;
+}
+
+uint32_t clock_resume(void)
+{
+    RCC->CR2 |= RCC_CR2_HSI14ON;
+    if (profiles[profile].pllmul)
+    {
+        switch_to_pll();
+    }
+    uint32_t back = SysTick->VAL;
+    while (!(RCC->CR2 & RCC_CR2_HSI14RDY))
+    {
+    }
+    return back;
+}
+
+void clock_stats(ClockStats *out)
+{
+    uint32_t total = 0;
+    uint64_t charge = 0;
+
+    account(HAL_GetTick());
+    for (uint8_t i = 0; i < CLOCK_PROFILES; i++)
+    {
+        total += stats.residency_ms[i];
+        charge += (uint64_t)stats.residency_ms[i] * profiles[i].idd_ua;
+    }
+    stats.estimated_ua = total ? charge / total : 0;
+
+    *out = stats;
+    stats = (ClockStats){0};
+}
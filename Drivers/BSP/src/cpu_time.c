@@ -0,0 +1,107 @@
+#include "cpu_time.h"
+#include "main.h"
+#include "midea_ir.h"
+#include "scheduler.h"
+#include <stdio.h>
+
+#ifdef CPU_TIME
+
+/**
+ * The cycle counters are 64 bit: scheduler_cycles() wraps in 90s at
+ * 48MHz, so the period is summed from the differences between two calls
+ * and every idle call keeps them close enough.
+ *
+ * With CLOCK_SCALING the shares are shares of core cycles, not of time:
+ * a millisecond at 48MHz weighs six times one at 8MHz.
+ */
+
+static const char *const state_names[CPU_STATES] = {
+    [CPU_RUN] = "run",
+    [CPU_IDLE] = "idle",
+    [CPU_IR] = "ir",
+    [CPU_SPI_WAIT] = "spi",
+    [CPU_UART_WAIT] = "uart",
+    [CPU_DELAY] = "delay",
+};
+
+static uint64_t state_cycles[CPU_STATES];
+static uint64_t period_cycles; // all cycles of the report period
+static uint32_t period_stamp;  // scheduler_cycles() of the last update
+static uint32_t period_start;  // HAL tick of the start of the period
+static uint32_t period_ir;     // IR cycles at the start of the period
+
+static void update_period(uint32_t now)
+{
+    period_cycles += now - period_stamp;
+    period_stamp = now;
+}
+
+void cpu_time_start(CpuTimer *timer)
+{
+    timer->cycles = scheduler_cycles();
+    timer->ir_cycles = midea_ir_isr_cycles();
+}
+
+void cpu_time_stop(CpuTimer *timer, CpuState state)
+{
+    uint32_t now = scheduler_cycles();
+
+    update_period(now);
+    state_cycles[state] += (now - timer->cycles) - (midea_ir_isr_cycles() - timer->ir_cycles);
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    CpuTimer timer;
+    uint32_t tickstart = HAL_GetTick();
+    uint32_t wait = Delay;
+
+    cpu_time_start(&timer);
+    if (wait < HAL_MAX_DELAY)
+    {
+        wait += (uint32_t)(uwTickFreq);
+    }
+    while ((HAL_GetTick() - tickstart) < wait)
+    {
+    }
+    cpu_time_stop(&timer, CPU_DELAY);
+}
+
+void cpu_time_report(void)
+{
+    uint64_t cycles[CPU_STATES];
+    uint64_t total;
+    uint64_t waits = 0;
+    uint32_t ir = midea_ir_isr_cycles();
+    uint32_t now = HAL_GetTick();
+    uint32_t ms = now - period_start;
+
+    update_period(scheduler_cycles());
+    state_cycles[CPU_IR] = ir - period_ir;
+    for (uint8_t i = 1; i < CPU_STATES; i++)
+    {
+        waits += state_cycles[i];
+    }
+    state_cycles[CPU_RUN] = period_cycles > waits ? period_cycles - waits : 0;
+
+    for (uint8_t i = 0; i < CPU_STATES; i++)
+    {
+        cycles[i] = state_cycles[i];
+        state_cycles[i] = 0;
+    }
+    total = period_cycles;
+    period_cycles = 0;
+    period_start = now;
+    period_ir = ir;
+
+    // printed after the reset, the output goes to the next period
+    printf("cpu %lu ms:", ms);
+    for (uint8_t i = 0; i < CPU_STATES; i++)
+    {
+        uint32_t permille = total ? cycles[i] * 1000 / total : 0;
+        printf(" %s %lu.%lu%%", state_names[i], permille / 10, permille % 10);
+    }
+    printf("\r\n");
+}
+
+#endif /* CPU_TIME */
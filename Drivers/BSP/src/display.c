@@ -7,53 +7,250 @@
 
 #include "main.h"
 #include "spi.h"
+#include "tim.h"
 #include "display.h"
+#include "spi_bus.h"
 
 SPI_HandleTypeDef* DISPLAY_SPI = &hspi1;
 
-static const uint8_t pattern[17] = {
-	0x3F, // 0
-	0x06, // 1
-	0x5B, // 2
-	0x4F, // 3
-	0x66, // 4
-	0x6D, // 5
-	0x7D, // 6
-	0x07, // 7
-	0x7F, // 8
-	0x6F, // 9
-	0x77, // A
-	0x7C, // b
-	0x39, // C
-	0x5E, // d
-	0x79, // E
-	0x71, // F
-	0x00  // empty
+#define PATTERN_0 0x3F
+#define PATTERN_1 0x06
+#define PATTERN_2 0x5B
+#define PATTERN_3 0x4F
+#define PATTERN_4 0x66
+#define PATTERN_5 0x6D
+#define PATTERN_6 0x7D
+#define PATTERN_7 0x07
+#define PATTERN_8 0x7F
+#define PATTERN_9 0x6F
+#define PATTERN_A 0x77
+#define PATTERN_B 0x7C // b
+#define PATTERN_C 0x39
+#define PATTERN_D 0x5E // d
+#define PATTERN_E 0x79
+#define PATTERN_F 0x71
+#define PATTERN_H 0x76
+#define PATTERN_L 0x38
+#define PATTERN_N 0x54 // n
+#define PATTERN_O 0x5C // o
+#define PATTERN_P 0x73
+#define PATTERN_R 0x50 // r
+#define PATTERN_T 0x78 // t
+#define PATTERN_U 0x3E
+#define PATTERN_Y 0x6E
+#define PATTERN_MINUS 0x40
+#define PATTERN_UNDERSCORE 0x08
+
+/*
+ * Ready to shift words of every value, built by the compiler from the
+ * patterns above: the segment bits are inverted and the tens digit goes
+ * to the low byte, the first one shifted out.
+ */
+#define WORD(tens, ones) (uint16_t)((0xFF - (tens)) | (0xFF - (ones)) << 8)
+#define DIGITS(t, o) WORD(PATTERN_##t, PATTERN_##o)
+#define DECIMAL_ROW(t) \
+	DIGITS(t, 0), DIGITS(t, 1), DIGITS(t, 2), DIGITS(t, 3), DIGITS(t, 4), \
+	DIGITS(t, 5), DIGITS(t, 6), DIGITS(t, 7), DIGITS(t, 8), DIGITS(t, 9)
+#define HEX_ROW(h) DECIMAL_ROW(h), \
+	DIGITS(h, A), DIGITS(h, B), DIGITS(h, C), DIGITS(h, D), DIGITS(h, E), DIGITS(h, F)
+
+static const uint16_t decimal_words[100] = {
+	DECIMAL_ROW(0), DECIMAL_ROW(1), DECIMAL_ROW(2), DECIMAL_ROW(3), DECIMAL_ROW(4),
+	DECIMAL_ROW(5), DECIMAL_ROW(6), DECIMAL_ROW(7), DECIMAL_ROW(8), DECIMAL_ROW(9)
 };
 
-void DisplayDecimal(uint8_t value){
-	uint8_t bcd[2] = {0, value};
-	while(bcd[1]>=10){
-		bcd[1]-=10;
-		bcd[0]++;
-		if(bcd[0]>=10){
-			bcd[0]-=10;
+static const uint16_t hex_words[256] = {
+	HEX_ROW(0), HEX_ROW(1), HEX_ROW(2), HEX_ROW(3), HEX_ROW(4), HEX_ROW(5), HEX_ROW(6), HEX_ROW(7),
+	HEX_ROW(8), HEX_ROW(9), HEX_ROW(A), HEX_ROW(B), HEX_ROW(C), HEX_ROW(D), HEX_ROW(E), HEX_ROW(F)
+};
+
+/*
+ * Segments of the printable characters from ' ' to '_', lower case is
+ * looked up as upper case. Characters without a glyph stay blank.
+ */
+#define GLYPH(c) [(c) - ' ']
+static const uint8_t glyphs[64] = {
+	GLYPH('0') = PATTERN_0, GLYPH('1') = PATTERN_1, GLYPH('2') = PATTERN_2, GLYPH('3') = PATTERN_3,
+	GLYPH('4') = PATTERN_4, GLYPH('5') = PATTERN_5, GLYPH('6') = PATTERN_6, GLYPH('7') = PATTERN_7,
+	GLYPH('8') = PATTERN_8, GLYPH('9') = PATTERN_9, GLYPH('A') = PATTERN_A, GLYPH('B') = PATTERN_B,
+	GLYPH('C') = PATTERN_C, GLYPH('D') = PATTERN_D, GLYPH('E') = PATTERN_E, GLYPH('F') = PATTERN_F,
+	GLYPH('H') = PATTERN_H, GLYPH('L') = PATTERN_L, GLYPH('N') = PATTERN_N, GLYPH('O') = PATTERN_O,
+	GLYPH('P') = PATTERN_P, GLYPH('R') = PATTERN_R, GLYPH('S') = PATTERN_5, GLYPH('T') = PATTERN_T,
+	GLYPH('U') = PATTERN_U, GLYPH('Y') = PATTERN_Y, GLYPH('-') = PATTERN_MINUS,
+	GLYPH('_') = PATTERN_UNDERSCORE
+};
+
+/*
+ * Framebuffer.
+ *
+ * The display functions only write the framebuffer and flush it. A flush
+ * queues an SPI bus transfer of the word if it differs from the one
+ * latched last, and returns right away. If the transfer is still queued,
+ * its completion flushes the framebuffer again, so the last write always
+ * ends up on the display.
+ */
+static volatile uint16_t frame;    // words as shifted out, tens digit in the low byte
+static uint16_t latched;           // word of the last transfer, read by DMA
+static bool latched_valid;         // latched was the last word sent, the PWM clears it
+static volatile uint16_t overlay;  // shown instead of frame while overlay_on
+static volatile bool overlay_on;
+
+/*
+ * Brightness.
+ *
+ * Below full brightness TIM16 requests a DMA transfer from pwm_words to
+ * the SPI data register every 250us, so each word is shifted out and
+ * latched in turn: the first brightness words are the framebuffer, the
+ * rest are blank. A PWM cycle is DISPLAY_LEVELS words, 4ms. No interrupt
+ * is involved, a flush only rewrites pwm_words. The PWM is the stream of
+ * the SPI bus, paused while other devices are addressed.
+ */
+#define DISPLAY_BLANK 0xFFFF
+
+static uint16_t pwm_words[DISPLAY_LEVELS];
+static uint8_t brightness = DISPLAY_LEVELS;
+static bool pwm_running;
+
+static void DisplayWrite(uint16_t word){
+	frame = word;
+	DisplayFlush();
+}
+
+static uint16_t DisplayShown(void){
+	return overlay_on ? overlay : frame;
+}
+
+static void DisplayDone(SpiTransfer* transfer);
+static void PwmStart(void);
+static void PwmStop(void);
+
+// 16 bit words latched by the NSS pulse, the shift registers take 250kHz
+static const SpiDevice display_device = {
+	.cs_port = NULL,
+	.data_size = SPI_DATASIZE_16BIT,
+	.max_hz = 250000,
+};
+static SpiTransfer display_transfer = {
+	.device = &display_device,
+	.data = &latched,
+	.count = 1,
+	.done = DisplayDone,
+};
+static const SpiStream display_stream = {
+	.device = &display_device,
+	.start = PwmStart,
+	.stop = PwmStop,
+};
+
+// The bus pauses the PWM for the transfers of other devices
+static void PwmStart(void){
+	__HAL_SPI_ENABLE(DISPLAY_SPI);
+	HAL_DMA_Start(htim16.hdma[TIM_DMA_ID_UPDATE], (uint32_t)pwm_words,
+			(uint32_t)&DISPLAY_SPI->Instance->DR, DISPLAY_LEVELS);
+	__HAL_TIM_ENABLE_DMA(&htim16, TIM_DMA_UPDATE);
+	HAL_TIM_Base_Start(&htim16);
+}
+
+static void PwmStop(void){
+	__HAL_TIM_DISABLE_DMA(&htim16, TIM_DMA_UPDATE);
+	HAL_TIM_Base_Stop(&htim16);
+	HAL_DMA_Abort(htim16.hdma[TIM_DMA_ID_UPDATE]);
+}
+
+static void PwmEnd(void){
+	spi_bus_stream(NULL);
+	pwm_running = false;
+	latched_valid = false;
+}
+
+void DisplaySetBrightness(uint8_t level){
+	brightness = level < DISPLAY_LEVELS ? level : DISPLAY_LEVELS;
+	DisplayFlush();
+}
+
+uint8_t DisplayGetBrightness(void){
+	return brightness;
+}
+
+void DisplaySuspend(void){
+	if(!pwm_running){
+		return;
+	}
+	PwmEnd();
+	DISPLAY_SPI->Instance->DR = DISPLAY_BLANK;
+	while(!(DISPLAY_SPI->Instance->SR & SPI_SR_TXE) || (DISPLAY_SPI->Instance->SR & SPI_SR_BSY)){
+	}
+}
+
+void DisplaySetSegments(uint8_t digit, uint8_t segments){
+	uint8_t shift = digit ? 8 : 0;
+	frame = (frame & ~(0xFF << shift)) | ((uint8_t)(0xFF - segments) << shift);
+}
+
+void DisplayFlush(void){
+	if(brightness < DISPLAY_LEVELS){
+		for(uint8_t i = 0; i < DISPLAY_LEVELS; i++){
+			pwm_words[i] = i < brightness ? DisplayShown() : DISPLAY_BLANK;
+		}
+		if(!pwm_running){
+			pwm_running = true;
+			spi_bus_stream(&display_stream);
 		}
+		return;
+	}
+	if(pwm_running){
+		PwmEnd();
+	}
+	if(display_transfer.queued){
+		return; // flushed again from DisplayDone
 	}
-	bcd[1] = 0xFF - pattern[bcd[1]];
-	bcd[0] = 0xFF - pattern[bcd[0]];
-	HAL_SPI_Transmit(DISPLAY_SPI, bcd, 1, HAL_MAX_DELAY);
+	if(latched_valid && DisplayShown() == latched){
+		return;
+	}
+	latched = DisplayShown();
+	latched_valid = true;
+	spi_bus_submit(&display_transfer);
+}
+
+static void DisplayDone(SpiTransfer* transfer){
+	DisplayFlush();
+}
+
+void DisplayDecimal(uint8_t value){
+	// only the last two digits fit
+	if(value >= 200){
+		value -= 200;
+	}else if(value >= 100){
+		value -= 100;
+	}
+	DisplayWrite(decimal_words[value]);
 }
 
 void DisplayHex(uint8_t value){
-	uint8_t data[2] = {
-		0xFF - pattern[(value>>4) & 0x0F],
-		0xFF - pattern[value & 0x0F]
-	};
-	HAL_SPI_Transmit(DISPLAY_SPI, data, 1, HAL_MAX_DELAY);
+	DisplayWrite(hex_words[value]);
 }
 
 void DisplayOff(void){
-	uint8_t data[2] = {0, 0};
-	HAL_SPI_Transmit(DISPLAY_SPI, data, 1, HAL_MAX_DELAY);
+	DisplayWrite(0);
+}
+
+uint8_t DisplayGlyph(char c){
+	if(c >= 'a' && c <= 'z'){
+		c -= 'a' - 'A';
+	}
+	if(c < ' ' || c > '_'){
+		return 0;
+	}
+	return glyphs[c - ' '];
+}
+
+void DisplayOverlay(uint8_t tens, uint8_t ones){
+	overlay = WORD(tens, ones);
+	overlay_on = true;
+	DisplayFlush();
+}
+
+void DisplayOverlayOff(void){
+	overlay_on = false;
+	DisplayFlush();
 }
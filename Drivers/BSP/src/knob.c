@@ -0,0 +1,158 @@
+#include "knob.h"
+#include "main.h"
+#include "adc.h"
+#include "midea_ir.h"
+
+/**
+ * The ADC runs in continuous mode from PCLK/4 with the longest sampling
+ * time, ~32k conversions per second, and DMA keeps the last KNOB_SAMPLES
+ * of them in samples[]. Nobody needs to know when a conversion is done,
+ * so the DMA interrupts are turned off and the moving average is only
+ * computed when the knob is read.
+ *
+ * The average is quantized to 160 counts per degree, the same scale as
+ * before. A position close to a bucket edge no longer flickers between
+ * two values: the bucket is only left once the value is HYSTERESIS
+ * counts past its edge.
+ *
+ * Built with KNOB_AWD the analog watchdog guards the same window around
+ * the current bucket, so the knob only needs to be read when it has
+ * moved. The watchdog compares single conversions, a noise spike only
+ * costs a read that finds the bucket unchanged. In the off buckets the
+ * window is narrowed to HYSTERESIS around the value read, never below the
+ * off edge: a move there is seen when the bucket changes too.
+ */
+
+#define KNOB_SAMPLES 64 // ~2ms of conversions
+#define BUCKET_SIZE  160
+#define BUCKET_OFF   (TEMP_HIGH - TEMP_LOW + 1) // first bucket meaning off
+#define HYSTERESIS   40
+
+static uint16_t samples[KNOB_SAMPLES];
+static uint8_t bucket;
+
+#ifdef KNOB_AWD
+static SchedulerTask *watcher;
+
+static void awd_arm(uint16_t value)
+{
+    int16_t low = bucket * BUCKET_SIZE - HYSTERESIS;
+    int16_t high = (bucket + 1) * BUCKET_SIZE + HYSTERESIS - 1;
+
+    if (bucket >= BUCKET_OFF)
+    {
+        if (value - HYSTERESIS > low)
+        {
+            low = value - HYSTERESIS;
+        }
+        if (value + HYSTERESIS < high)
+        {
+            high = value + HYSTERESIS;
+        }
+    }
+    if (low < 0)
+    {
+        low = 0;
+    }
+    if (high > 4095)
+    {
+        high = 4095;
+    }
+
+    // TR may change during conversions, unlike the rest HAL_ADC_AnalogWDGConfig() sets
+    hadc.Instance->TR = ADC_TRX_HIGHTHRESHOLD(high) | low;
+    __HAL_ADC_CLEAR_FLAG(&hadc, ADC_FLAG_AWD);
+    if (watcher)
+    {
+        __HAL_ADC_ENABLE_IT(&hadc, ADC_IT_AWD);
+    }
+}
+
+void knob_watch(SchedulerTask *task)
+{
+    watcher = task;
+    awd_arm(knob_value());
+}
+
+void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc)
+{
+    __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD); // armed again once the knob is read
+    scheduler_post(watcher);
+}
+#endif
+
+static void start(void)
+{
+    if (HAL_ADC_Start_DMA(&hadc, (uint32_t *)samples, KNOB_SAMPLES) != HAL_OK)
+    {
+        Error_Handler();
+    }
+    __HAL_DMA_DISABLE_IT(hadc.DMA_Handle, DMA_IT_HT | DMA_IT_TC);
+}
+
+void knob_init(void)
+{
+    if (HAL_ADCEx_Calibration_Start(&hadc) != HAL_OK)
+    {
+        Error_Handler();
+    }
+#ifdef KNOB_AWD
+    ADC_AnalogWDGConfTypeDef AnalogWDGConfig = {0};
+
+    AnalogWDGConfig.WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG;
+    AnalogWDGConfig.Channel = ADC_CHANNEL_6;
+    AnalogWDGConfig.ITMode = DISABLE;
+    AnalogWDGConfig.HighThreshold = 4095;
+    AnalogWDGConfig.LowThreshold = 0;
+    if (HAL_ADC_AnalogWDGConfig(&hadc, &AnalogWDGConfig) != HAL_OK)
+    {
+        Error_Handler();
+    }
+#endif
+    start();
+}
+
+void knob_suspend(void)
+{
+    if (HAL_ADC_Stop_DMA(&hadc) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+void knob_resume(void)
+{
+    start();
+}
+
+uint16_t knob_value(void)
+{
+    uint32_t sum = 0;
+
+    for (uint8_t i = 0; i < KNOB_SAMPLES; i++)
+    {
+        sum += samples[i];
+    }
+    return sum / KNOB_SAMPLES;
+}
+
+uint8_t knob_temperature(void)
+{
+    uint16_t value = knob_value();
+    uint16_t low = bucket * BUCKET_SIZE;
+
+    if (value + HYSTERESIS < low || value >= low + BUCKET_SIZE + HYSTERESIS)
+    {
+        bucket = value / BUCKET_SIZE;
+    }
+
+#ifdef KNOB_AWD
+    awd_arm(value);
+#endif
+
+    if (bucket >= BUCKET_OFF)
+    {
+        return KNOB_OFF;
+    }
+    return bucket + TEMP_LOW;
+}
@@ -56,42 +56,82 @@
 
 #define RAW_DATA_PACKET_SIZE 6 // each byte is sent two times
 
-typedef struct
-{
-    uint8_t magic; // 0xB2 always
-    uint8_t state : 4;
-    uint8_t fan : 4;
-    uint8_t command : 4;
-    uint8_t temp : 4;
-} DataPacket;
-
-// Table to convert temperature in Celsius to a strange Midea AirCon values
-const static uint8_t temperature_table[] = {
-    0b0000, // 17 C
-    0b0001, // 18 C
-    0b0011, // 19 C
-    0b0010, // 20 C
-    0b0110, // 21 C
-    0b0111, // 22 C
-    0b0101, // 23 C
-    0b0100, // 24 C
-    0b1100, // 25 C
-    0b1101, // 26 C
-    0b1001, // 27 C
-    0b1000, // 28 C
-    0b1010, // 29 C
-    0b1011  // 30 C
-    //  0b1110    // off
-};
+// Temperature in Celsius to a strange Midea AirCon values, from TEMP_LOW
+#define TEMPERATURE_CODES(X, ...) \
+    X(0b0000, __VA_ARGS__) /* 17 C */ \
+    X(0b0001, __VA_ARGS__) /* 18 C */ \
+    X(0b0011, __VA_ARGS__) /* 19 C */ \
+    X(0b0010, __VA_ARGS__) /* 20 C */ \
+    X(0b0110, __VA_ARGS__) /* 21 C */ \
+    X(0b0111, __VA_ARGS__) /* 22 C */ \
+    X(0b0101, __VA_ARGS__) /* 23 C */ \
+    X(0b0100, __VA_ARGS__) /* 24 C */ \
+    X(0b1100, __VA_ARGS__) /* 25 C */ \
+    X(0b1101, __VA_ARGS__) /* 26 C */ \
+    X(0b1001, __VA_ARGS__) /* 27 C */ \
+    X(0b1000, __VA_ARGS__) /* 28 C */ \
+    X(0b1010, __VA_ARGS__) /* 29 C */ \
+    X(0b1011, __VA_ARGS__) /* 30 C */
+//  0b1110 - off
+
+// Fan level 0..3 to fan control
+#define FAN_CODES(X, ...) \
+    X(0b1011, __VA_ARGS__) /* 0 */ \
+    X(0b1001, __VA_ARGS__) /* 1 */ \
+    X(0b0101, __VA_ARGS__) /* 2 */ \
+    X(0b0011, __VA_ARGS__) /* 3 */
+
+#define TEMP_DEFAULT (24 - TEMP_LOW) // sent for temperatures out of range
+#define FAN_DEFAULT 0                 // sent for fan levels out of range
+
+/**
+ * Frame table.
+ *
+ * Every frame the remote can send is built here by the preprocessor, so a
+ * send is a single lookup in flash instead of packing and inverting the
+ * bytes every time. The state frames are indexed by command >> 2, fan
+ * level and temperature; the fan level is ignored in automatic mode and
+ * the temperature in fan mode, those rows repeat the same frame.
+ *
+ * The codes above are the only source of both, the table can not get out
+ * of sync with the protocol description.
+ */
 
-// Table to convert fan level
-const static uint8_t fan_table[] = {
-    0b1011, // 0
-    0b1001, // 1
-    0b0101, // 2
-    0b0011, // 3
+#define PAYLOAD(b0, b1, b2) \
+    {(b0), (uint8_t)~(b0), (b1), (uint8_t)~(b1), (b2), (uint8_t)~(b2)}
+
+// [1010 0010] [ffff ssss] [ttttcccc]
+#define DATA_PACKET(fan, state, temp, command) \
+    PAYLOAD(0xB2, ((fan) << 4) | (state), ((temp) << 4) | (command))
+
+#define CODE_AS_IS(code) (code)
+#define FAN_IRRELEVANT(code) 0b0001
+#define TEMP_OFF(code) 0b1110
+
+#define STATE_FRAME(temp, fan, command, fan_of, temp_of) \
+    DATA_PACKET(fan_of(fan), 0b1111, temp_of(temp), command),
+#define FAN_ROW(fan, command, fan_of, temp_of) \
+    {TEMPERATURE_CODES(STATE_FRAME, fan, command, fan_of, temp_of)},
+#define MODE_ROWS(command, fan_of, temp_of) \
+    {FAN_CODES(FAN_ROW, command, fan_of, temp_of)}
+
+#define TEMP_COUNT (TEMP_HIGH - TEMP_LOW + 1)
+#define FAN_COUNT 4
+#define MODE_COUNT 4
+
+const static uint8_t state_frames[MODE_COUNT][FAN_COUNT][TEMP_COUNT][RAW_DATA_PACKET_SIZE] = {
+    MODE_ROWS(MODE_COOL, CODE_AS_IS, CODE_AS_IS),         // 0000
+    MODE_ROWS(MODE_FAN, CODE_AS_IS, TEMP_OFF),            // 0100
+    MODE_ROWS(MODE_AUTO, FAN_IRRELEVANT, CODE_AS_IS),     // 1000
+    MODE_ROWS(MODE_HEAT, CODE_AS_IS, CODE_AS_IS),         // 1100
 };
 
+const static uint8_t off_frame[RAW_DATA_PACKET_SIZE] =
+    DATA_PACKET(0b0111, 0b1011, 0b1110, 0b0000);
+
+const static uint8_t deflector_frame[RAW_DATA_PACKET_SIZE] =
+    PAYLOAD(0xB2, 0x0F, 0xE0);
+
 /**
  * Implementation of pulses processing.
  *
@@ -113,98 +153,682 @@ const static uint8_t fan_table[] = {
 
 #define PULSES_CAPACITY 29      // 8T + 8T + (4T * 8 * 6) + 8T
 #define SUB_PULSES_PER_PULSE 42 // (high + low) * 21
+#define TICKS_PER_PULSE (SUB_PULSES_PER_PULSE + 1) // +1 tick to step to the next pulse
 
 typedef struct
 {
     uint8_t pin_number;
+#ifdef MIDEA_IR_STREAM_ENCODER
+    uint8_t data[RAW_DATA_PACKET_SIZE]; // bytes to spit out
+#else
     uint8_t pulses[PULSES_CAPACITY]; // pulses to spit out
     uint8_t pulses_size;
-    uint8_t repeat_count;      // how many times to repeat
-    uint8_t current_pulse;     // current processing pulse
-    uint8_t current_sub_pulse; // 38000 kHz pulse
+    uint8_t current_pulse; // current pulse being encoded
+#endif
+    uint8_t repeat_count; // how many times to repeat
 } IrState;
 
 static volatile IrState ir_state;
 
-void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
+static void frame_done(void);
+
+#ifdef MIDEA_IR_PREEMPT
+static volatile bool tx_abort; // newer state waits, end the frame at a space
+#else
+#define tx_abort false
+#endif
+
+#define BSRR_SET   ((uint32_t)IR_LED_Pin)
+#define BSRR_RESET ((uint32_t)IR_LED_Pin << 16)
+
+/**
+ * The interrupt engine runs from SRAM: with FLASH_LATENCY_1 every fetch
+ * from flash costs a wait state, which adds up at 76kHz. Only the
+ * handler and what it calls are moved, to keep RAM usage low: the
+ * cursor, bench_exit() and isr_start(). frame_done() and the encoder it
+ * runs stay in flash, they come once per frame after the exit sample.
+ * Define MIDEA_IR_ISR_IN_FLASH to keep it in flash, e.g. to compare both
+ * with MIDEA_IR_ISR_BENCH.
+ */
+#if MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_ISR && !defined(MIDEA_IR_ISR_IN_FLASH)
+#define IR_RAMFUNC __attribute__((section(".RamFunc")))
+#else
+#define IR_RAMFUNC
+#endif
+
+#if defined(MIDEA_IR_ISR_BENCH) || defined(CPU_TIME) || defined(MIDEA_IR_ISR_LATENCY)
+/**
+ * TIM1 runs from the undivided core clock, so its counter read on entry
+ * and exit of the handler gives the number of cycles spent in it. The
+ * counter restarts from 0 on the update event, so the value read on exit
+ * also includes the exception entry and any dispatching in front of the
+ * handler, and the value read on entry is the entry latency.
+ *
+ * The exit is sampled before frame_done(): starting the next frame
+ * resets the counter. The frame change itself is left out of the counts.
+ */
+#ifdef MIDEA_IR_ISR_BENCH
+static MideaIRBench ir_bench;
+#endif
+#ifdef CPU_TIME
+static volatile uint32_t isr_cycles;
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+/**
+ * A tick is late when its carrier edge is moved by more than a quarter
+ * of the tick, and missed when the next update is already pending as the
+ * handler returns: that one is serviced late, or merged with the one
+ * after if the delay is a whole tick. With the PWM engine the counter
+ * wraps every carrier period, so latencies are modulo one period there.
+ */
+static MideaIRLatency latency_run;   // frame on air
+static MideaIRLatency latency_frame; // last finished frame
+#endif
+
+#define BENCH_ENTRY() uint16_t bench_entry = TIM1->CNT
+#define BENCH_EXIT() bench_exit(bench_entry)
+
+IR_RAMFUNC static inline void bench_exit(uint16_t entry)
 {
-    // get current pulse value
-    bool pulse_val = ir_state.pulses[ir_state.current_pulse / 8] & (1 << (ir_state.current_pulse % 8));
+    uint16_t exit = TIM1->CNT;
+    uint16_t cycles = exit - entry;
 
-    if (ir_state.current_sub_pulse < SUB_PULSES_PER_PULSE)
+    if (exit < entry)
+    { // handler overran the update period
+        cycles += TIM1->ARR + 1;
+    }
+
+#ifdef CPU_TIME
+    isr_cycles += cycles;
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+    uint8_t bucket = 0;
+    while (bucket < MIDEA_IR_LATENCY_BUCKETS - 1 && (entry >> bucket))
+    {
+        bucket++;
+    }
+    latency_run.histogram[bucket]++;
+    latency_run.ticks++;
+    if (entry > latency_run.max_latency)
+    {
+        latency_run.max_latency = entry;
+    }
+    if (entry > (TIM1->ARR + 1) / 4)
+    {
+        latency_run.late++;
+    }
+    if (TIM1->SR & TIM_SR_UIF)
+    {
+        latency_run.missed++;
+    }
+#endif
+#ifdef MIDEA_IR_ISR_BENCH
+    if (cycles > ir_bench.max_cycles)
     {
-        if (!(ir_state.current_sub_pulse % 2) && pulse_val)
+        ir_bench.max_cycles = cycles;
+    }
+    if (exit > ir_bench.max_exit)
+    {
+        ir_bench.max_exit = exit;
+    }
+#endif
+}
+#else
+#define BENCH_ENTRY()
+#define BENCH_EXIT()
+#endif
+
+#ifdef CPU_TIME
+uint32_t midea_ir_isr_cycles(void)
+{
+    return isr_cycles;
+}
+#endif
+
+#ifdef MIDEA_IR_ISR_LATENCY
+void midea_ir_latency(MideaIRLatency *latency)
+{
+    __disable_irq();
+    *latency = latency_frame;
+    __enable_irq();
+}
+#endif
+
+#ifdef MIDEA_IR_ISR_BENCH
+void midea_ir_bench(MideaIRBench *bench)
+{
+    __disable_irq();
+    *bench = ir_bench;
+    ir_bench.max_cycles = 0;
+    ir_bench.max_exit = 0;
+    __enable_irq();
+    bench->budget = (TIM1->ARR + 1) * (TIM1->RCR + 1);
+}
+#endif
+
+/**
+ * Pulse cursor.
+ *
+ * The transmit engines walk the frame one pulse at a time through
+ * cursor_rewind(), cursor_mark() and cursor_step(), and cursor_next()
+ * adds the repeats and the preemption on top. The cursor is only touched
+ * by the engine while a frame is on air, so it is not volatile.
+ */
+
+typedef struct
+{
+#ifdef MIDEA_IR_STREAM_ENCODER
+    uint8_t byte;     // data byte of the current bit
+    uint8_t bit;      // mask of the current bit in the byte
+    uint8_t phase;    // part of the frame being sent
+    uint8_t run_left; // pulses left in the current run, current one included
+    bool mark;        // the current run is made of marks
+#else
+    const uint8_t *byte;  // pulses byte of the current pulse
+    uint8_t mask;         // bit of the current pulse in *byte
+    uint8_t pulses_left;  // pulses after the current one
+#endif
+    uint8_t sub_pulse; // 38000 kHz pulse
+} IrCursor;
+
+static IrCursor ir_cursor;
+
+#ifdef MIDEA_IR_STREAM_ENCODER
+/**
+ * With MIDEA_IR_STREAM_ENCODER the pulses are never stored: the cursor
+ * reads the data bytes and produces the same pulses on the fly, as runs
+ * of equal pulses.
+ *
+ *   start condition: 8 marks, 8 spaces
+ *   each bit:        1 mark, 1 space for "0" or 3 spaces for "1"
+ *   stop:            1 mark, 3 + 8 spaces
+ *
+ * The phases follow each other through next_runs[] rather than a
+ * switch: on Cortex-M0 a switch may become a call to a libgcc table
+ * helper, which stays in flash. The table is in .data for the same
+ * reason, so the handler reads it from SRAM.
+ */
+
+enum
+{
+    PHASE_START_MARK,
+    PHASE_START_SPACE,
+    PHASE_BIT_MARK,
+    PHASE_BIT_SPACE,
+    PHASE_STOP_MARK,
+    PHASE_STOP_SPACE,
+    PHASES
+};
+
+typedef struct
+{
+    uint8_t phase;
+    bool mark;
+    uint8_t length; // 0 after the last phase
+} CursorRun;
+
+// run that follows each phase
+static CursorRun next_runs[PHASES] = {
+    [PHASE_START_MARK] = {PHASE_START_SPACE, false, 8},
+    [PHASE_START_SPACE] = {PHASE_BIT_MARK, true, 1},
+    [PHASE_BIT_MARK] = {PHASE_BIT_SPACE, false, 1},  // 3 for a "1"
+    [PHASE_BIT_SPACE] = {PHASE_BIT_MARK, true, 1},   // the stop mark after the last bit
+    [PHASE_STOP_MARK] = {PHASE_STOP_SPACE, false, 3 + 8},
+    [PHASE_STOP_SPACE] = {0},
+};
+
+IR_RAMFUNC static inline void cursor_run(uint8_t phase, bool mark, uint8_t length)
+{
+    ir_cursor.phase = phase;
+    ir_cursor.mark = mark;
+    ir_cursor.run_left = length;
+}
+
+IR_RAMFUNC static inline void cursor_rewind(void)
+{
+    ir_cursor.byte = 0;
+    ir_cursor.bit = 0x80;
+    cursor_run(PHASE_START_MARK, true, 8);
+}
+
+IR_RAMFUNC static inline bool cursor_mark(void)
+{
+    return ir_cursor.mark;
+}
+
+// steps to the next pulse, false at the end of the frame
+IR_RAMFUNC static bool cursor_step(void)
+{
+    if (--ir_cursor.run_left)
+    {
+        return true;
+    }
+
+    const CursorRun *run = &next_runs[ir_cursor.phase];
+    uint8_t phase = run->phase;
+    uint8_t length = run->length;
+
+    if (!length)
+    {
+        return false;
+    }
+    if (ir_cursor.phase == PHASE_BIT_MARK)
+    {
+        if (ir_state.data[ir_cursor.byte] & ir_cursor.bit)
+        {
+            length = 3;
+        }
+    }
+    else if (ir_cursor.phase == PHASE_BIT_SPACE)
+    {
+        ir_cursor.bit >>= 1;
+        if (!ir_cursor.bit)
         {
-            HAL_GPIO_WritePin(IR_LED_GPIO_Port, IR_LED_Pin, GPIO_PIN_RESET);
+            ir_cursor.bit = 0x80;
+            ir_cursor.byte++;
         }
-        else
+        if (ir_cursor.byte == RAW_DATA_PACKET_SIZE)
         {
-            HAL_GPIO_WritePin(IR_LED_GPIO_Port, IR_LED_Pin, GPIO_PIN_SET);
+            phase = PHASE_STOP_MARK;
         }
-        ir_state.current_sub_pulse++;
+    }
+    cursor_run(phase, run->mark, length);
+    return true;
+}
+#else
+IR_RAMFUNC static inline void cursor_rewind(void)
+{
+    ir_cursor.byte = (const uint8_t *)ir_state.pulses;
+    ir_cursor.mask = 1;
+    ir_cursor.pulses_left = ir_state.pulses_size - 1;
+}
+
+IR_RAMFUNC static inline bool cursor_mark(void)
+{
+    return *ir_cursor.byte & ir_cursor.mask;
+}
+
+// steps to the next pulse, false at the end of the frame
+IR_RAMFUNC static bool cursor_step(void)
+{
+    if (!ir_cursor.pulses_left)
+    {
+        return false;
+    }
+
+    ir_cursor.pulses_left--;
+    ir_cursor.mask <<= 1;
+    if (!ir_cursor.mask)
+    {
+        ir_cursor.byte++;
+        ir_cursor.mask = 1;
+    }
+    return true;
+}
+#endif
+
+// steps to the next pulse to send, false when the frame and its repeats are over
+IR_RAMFUNC static bool cursor_next(void)
+{
+    if (tx_abort && !cursor_mark())
+    { // newer state waits, give up the frame and its repeats after a space
+        ir_state.repeat_count = 0;
+        return false;
+    }
+
+    if (cursor_step())
+    {
+        return true;
+    }
+
+    ir_state.repeat_count--;
+    if (ir_state.repeat_count)
+    {
+        cursor_rewind();
+        return true;
+    }
+    return false;
+}
+
+#if MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_ISR
+
+/**
+ * Interrupt transmit engine.
+ *
+ * The handler runs on every TIM1 update, ~76kHz, and has 421 cycles at
+ * 32MHz to do its job. It replaces HAL_TIM_IRQHandler and keeps the BSRR
+ * word for the even sub-pulses of the current pulse next to the cursor,
+ * so a tick is a single compare and register write. The cursor only
+ * moves once per pulse.
+ */
+
+static uint32_t isr_even_word; // BSRR word of the even sub-pulses
+
+IR_RAMFUNC static inline void isr_load_pulse(void)
+{
+    ir_cursor.sub_pulse = 0;
+    isr_even_word = cursor_mark() ? BSRR_RESET : BSRR_SET;
+}
+
+// false when the frame is over, TIM1 is stopped then
+IR_RAMFUNC static bool isr_next_pulse(void)
+{
+    if (cursor_next())
+    {
+        isr_load_pulse();
+        return true;
+    }
+
+    TIM1->DIER &= ~TIM_DIER_UIE;
+    TIM1->CR1 &= ~TIM_CR1_CEN;
+    IR_LED_GPIO_Port->BSRR = BSRR_RESET;
+    return false;
+}
+
+IR_RAMFUNC void TIM1_BRK_UP_TRG_COM_IRQHandler(void)
+{
+    bool frame_over = false;
+
+    BENCH_ENTRY();
+
+    TIM1->SR = ~TIM_SR_UIF;
+
+    if (ir_cursor.sub_pulse < SUB_PULSES_PER_PULSE)
+    {
+        IR_LED_GPIO_Port->BSRR = (ir_cursor.sub_pulse & 1) ? BSRR_SET : isr_even_word;
+        ir_cursor.sub_pulse++;
     }
     else
     { // pulse is finished
-        ir_state.current_sub_pulse = 0;
-        ir_state.current_pulse++;
-        if (ir_state.current_pulse >= ir_state.pulses_size)
-        {
-            ir_state.repeat_count--;
-            if (ir_state.repeat_count)
-            {
-                ir_state.current_pulse = 0;
-                ir_state.current_sub_pulse = 0;
-            }
-            else
-            {
-                HAL_TIM_Base_Stop_IT(&htim1);
-                HAL_GPIO_WritePin(IR_LED_GPIO_Port, IR_LED_Pin, GPIO_PIN_RESET);
-            }
-        }
+        frame_over = !isr_next_pulse();
+    }
+
+    BENCH_EXIT();
+    if (frame_over)
+    { // after the exit sample, the next frame restarts TIM1 from 0
+        frame_done();
     }
 }
 
-static inline void pack_data(MideaIR *ir, DataPacket *data)
+IR_RAMFUNC static void isr_start(void)
 {
-    data->magic = 0xB2;
-    if (ir->enabled)
+    cursor_rewind();
+    isr_load_pulse();
+    TIM1->CNT = 0;
+    TIM1->SR = ~TIM_SR_UIF;
+    TIM1->DIER |= TIM_DIER_UIE;
+    TIM1->CR1 |= TIM_CR1_CEN;
+}
+
+#elif MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_DMA
+
+/**
+ * DMA transmit engine.
+ *
+ * Every TIM1 update event requests one DMA transfer from dma_buff to
+ * GPIOA->BSRR, so the carrier is generated without any CPU involvement.
+ * A whole frame would need 220 * 43 words, so the pulses are streamed
+ * instead: dma_buff is circular and while DMA plays one half, the other
+ * one is expanded from the pulse cursor in the half-transfer and
+ * transfer-complete callbacks. The cursor keeps its position between two
+ * callbacks, so the half size does not have to match the pulse length.
+ *
+ * The waveform is the same as the one of the interrupt engine, including
+ * the extra tick spent between two pulses.
+ */
+
+#ifndef MIDEA_IR_DMA_HALF_SIZE
+#define MIDEA_IR_DMA_HALF_SIZE 48 // ticks per half buffer, ~630us at 76kHz
+#endif
+
+static uint32_t dma_buff[2][MIDEA_IR_DMA_HALF_SIZE];
+static int8_t dma_idle_half; // half in which the frame ended or -1
+
+_Static_assert(sizeof(dma_buff) <= 512, "IR DMA buffer exceeds its RAM budget");
+
+static void fill_half(int8_t half)
+{
+    uint32_t *dst = dma_buff[half];
+    bool on_air = ir_state.repeat_count;
+    bool pulse_val = on_air && cursor_mark();
+
+    for (uint8_t i = 0; i < MIDEA_IR_DMA_HALF_SIZE; i++)
     {
-        if (ir->mode == MODE_AUTO)
-        {
-            data->fan = 0b0001; // for auto mode fan must be 0b0001
-        }
-        else
-        {
-            data->fan = fan_table[ir->fan_level];
+        if (!on_air)
+        { // frame is finished, keep the LED idle until DMA is stopped
+            if (dma_idle_half < 0)
+            {
+                dma_idle_half = half;
+            }
+            dst[i] = BSRR_RESET;
+            continue;
         }
-        data->state = 0b1111; // on
-        data->command = ir->mode;
 
-        if (ir->mode == MODE_FAN)
+        if (ir_cursor.sub_pulse < SUB_PULSES_PER_PULSE)
         {
-            data->temp = 0b1110;
-        }
-        else
-        {
-            if (ir->temperature >= TEMP_LOW && ir->temperature <= TEMP_HIGH)
-            {
-                data->temp = temperature_table[ir->temperature - TEMP_LOW];
-            }
-            else
-            {
-                data->temp = 0b0100;
-            }
+            dst[i] = (!(ir_cursor.sub_pulse % 2) && pulse_val) ? BSRR_RESET : BSRR_SET;
+            ir_cursor.sub_pulse++;
+            continue;
         }
+
+        // pulse is finished
+        ir_cursor.sub_pulse = 0;
+        on_air = cursor_next();
+        dst[i] = on_air ? BSRR_SET : BSRR_RESET;
+        pulse_val = on_air && cursor_mark();
+    }
+}
+
+static void dma_stop(void)
+{
+    __HAL_TIM_DISABLE_DMA(&htim1, TIM_DMA_UPDATE);
+    HAL_TIM_Base_Stop(&htim1);
+    HAL_DMA_Abort(htim1.hdma[TIM_DMA_ID_UPDATE]);
+    HAL_GPIO_WritePin(IR_LED_GPIO_Port, IR_LED_Pin, GPIO_PIN_RESET);
+}
+
+static void dma_half_done(int8_t half)
+{
+#ifdef CPU_TIME
+    // a half lasts less than a millisecond, so SysTick wraps at most once.
+    // Tickless rewrites LOAD, but every period it loads is whole
+    // milliseconds: after a wrap the counter is read modulo a millisecond
+    uint32_t start = SysTick->VAL;
+#endif
+
+    if (half == dma_idle_half)
+    { // the half with the end of the frame has been played
+        dma_stop();
+        frame_done();
     }
     else
     {
-        data->fan = 0b0111;
-        data->state = 0b1011; // off
-        data->command = 0b0000;
-        data->temp = 0b1110;
+        fill_half(half);
     }
+
+#ifdef CPU_TIME
+    uint32_t ms_cycles = SystemCoreClock / 1000;
+    uint32_t end = SysTick->VAL;
+    isr_cycles += end <= start ? start - end : start + ms_cycles - end % ms_cycles;
+#endif
+}
+
+static void dma_half_cplt(DMA_HandleTypeDef *hdma)
+{
+    dma_half_done(0);
+}
+
+static void dma_cplt(DMA_HandleTypeDef *hdma)
+{
+    dma_half_done(1);
 }
 
+void TIM1_BRK_UP_TRG_COM_IRQHandler(void)
+{
+    // update interrupt is not enabled, TIM1 only requests DMA transfers
+    TIM1->SR = ~TIM_SR_UIF;
+}
+
+static void dma_start(void)
+{
+    DMA_HandleTypeDef *hdma = htim1.hdma[TIM_DMA_ID_UPDATE];
+
+    cursor_rewind();
+    ir_cursor.sub_pulse = 0;
+    dma_idle_half = -1;
+    fill_half(0);
+    fill_half(1);
+
+    hdma->XferHalfCpltCallback = dma_half_cplt;
+    hdma->XferCpltCallback = dma_cplt;
+    HAL_DMA_Start_IT(hdma, (uint32_t)dma_buff, (uint32_t)&IR_LED_GPIO_Port->BSRR,
+                     sizeof(dma_buff) / sizeof(uint32_t));
+
+    __HAL_TIM_SET_COUNTER(&htim1, 0);
+    __HAL_TIM_ENABLE_DMA(&htim1, TIM_DMA_UPDATE);
+    HAL_TIM_Base_Start(&htim1);
+}
+
+#elif MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_PWM
+
+#ifndef BOARD_IR_LED_PA10
+#error "PWM transmit engine needs the IR LED on a TIM1 channel, define BOARD_IR_LED_PA10"
+#endif
+
+/**
+ * PWM transmit engine.
+ *
+ * TIM1 channel 3 generates the 38kHz carrier in hardware and the
+ * repetition counter stretches the update event to one pulse (21 carrier
+ * periods), so the interrupt only fires on pulse boundaries.
+ *
+ * The output is gated through the preloaded CCR3 instead of CCER/MOE:
+ * those are written immediately, while CCR3 is latched by the update
+ * event itself. The interrupt preloads the compare value of the next
+ * pulse (50% duty for mark, 0% for space) and the switch happens exactly
+ * on the carrier period boundary, regardless of interrupt latency.
+ *
+ * Output polarity is low, so spaces and the first half of every carrier
+ * period match the levels of the bit-banged engine.
+ */
+
+#define CARRIER_PERIODS_PER_PULSE (SUB_PULSES_PER_PULSE / 2)
+
+static bool pwm_tail; // last pulse is being played
+
+static inline uint32_t carrier_period(void)
+{
+    return 2 * (htim1.Init.Period + 1);
+}
+
+static inline void pwm_pin(bool timer)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    GPIO_InitStruct.Pin = IR_LED_Pin;
+    GPIO_InitStruct.Pull = GPIO_NOPULL;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    if (timer)
+    {
+        GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+        GPIO_InitStruct.Alternate = GPIO_AF2_TIM1;
+    }
+    else
+    {
+        GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    }
+    HAL_GPIO_Init(IR_LED_GPIO_Port, &GPIO_InitStruct);
+}
+
+static inline uint32_t pulse_compare(void)
+{
+    return cursor_mark() ? carrier_period() / 2 : 0;
+}
+
+// preloads the pulse following the one latched by the last update event
+static void pwm_preload_next(void)
+{
+    if (cursor_next())
+    {
+        TIM1->CCR3 = pulse_compare();
+    }
+    else
+    {
+        pwm_tail = true;
+        TIM1->CCR3 = 0;
+    }
+}
+
+static void pwm_init(void)
+{
+    TIM_OC_InitTypeDef sConfigOC = {0};
+
+    sConfigOC.OCMode = TIM_OCMODE_PWM1;
+    sConfigOC.Pulse = 0;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_LOW;
+    sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+    sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    if (HAL_TIM_PWM_ConfigChannel(&htim1, &sConfigOC, TIM_CHANNEL_3) != HAL_OK)
+    {
+        Error_Handler();
+    }
+}
+
+static void pwm_stop(void)
+{
+    __HAL_TIM_DISABLE_IT(&htim1, TIM_IT_UPDATE);
+    HAL_TIM_PWM_Stop(&htim1, TIM_CHANNEL_3);
+    pwm_pin(false);
+    HAL_GPIO_WritePin(IR_LED_GPIO_Port, IR_LED_Pin, GPIO_PIN_RESET);
+}
+
+static void pwm_start(void)
+{
+    pwm_tail = false;
+    cursor_rewind();
+
+    __HAL_TIM_SET_COUNTER(&htim1, 0);
+    __HAL_TIM_SET_AUTORELOAD(&htim1, carrier_period() - 1);
+    htim1.Instance->RCR = CARRIER_PERIODS_PER_PULSE - 1;
+    __HAL_TIM_SET_COMPARE(&htim1, TIM_CHANNEL_3, pulse_compare());
+    htim1.Instance->EGR = TIM_EGR_UG; // latch ARR, RCR and the first pulse
+    __HAL_TIM_CLEAR_IT(&htim1, TIM_IT_UPDATE);
+    pwm_preload_next();
+
+    pwm_pin(true);
+    __HAL_TIM_ENABLE_IT(&htim1, TIM_IT_UPDATE);
+    HAL_TIM_PWM_Start(&htim1, TIM_CHANNEL_3);
+}
+
+void TIM1_BRK_UP_TRG_COM_IRQHandler(void)
+{
+    BENCH_ENTRY();
+
+    TIM1->SR = ~TIM_SR_UIF;
+
+    // the pulse preloaded by the previous call has just started
+    bool frame_over = pwm_tail;
+    if (frame_over)
+    {
+        pwm_stop();
+        pwm_tail = false;
+    }
+    else
+    {
+        pwm_preload_next();
+    }
+
+    BENCH_EXIT();
+    if (frame_over)
+    { // after the exit sample, the next frame restarts TIM1 from 0
+        frame_done();
+    }
+}
+
+#endif
+
 void midea_ir_init(MideaIR *ir)
 {
     ir_state.repeat_count = 0; // indicates IDLE state
@@ -215,12 +839,15 @@ void midea_ir_init(MideaIR *ir)
     ir->fan_level = 0;
 
     HAL_GPIO_WritePin(IR_LED_GPIO_Port, IR_LED_Pin, GPIO_PIN_RESET);
+#if MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_PWM
+    pwm_init();
+#endif
 }
 
+#ifndef MIDEA_IR_STREAM_ENCODER
 static inline void init_buff()
 {
     ir_state.current_pulse = 0;
-    ir_state.current_sub_pulse = 0;
 
     for (uint8_t i = 0; i < PULSES_CAPACITY; i++)
     {
@@ -258,33 +885,32 @@ static inline void add_stop()
     add_bit(true);
     ir_state.current_pulse += 8;
 }
+#endif
 
 static inline void start(const uint8_t repeat)
 {
+#ifndef MIDEA_IR_STREAM_ENCODER
     ir_state.pulses_size = ir_state.current_pulse;
-    ir_state.current_pulse = 0;
-    ir_state.current_sub_pulse = 0;
+#endif
     ir_state.repeat_count = repeat;
-    HAL_TIM_Base_Start_IT(&htim1);
-}
-
-/* For each byte in src add two bytes in dst (normal and bit-wise inverted)
- */
-static inline void add_complementary_bytes(const uint8_t *src, uint8_t *dst)
-{
-    for (int i = 0; i < 3; i++)
-    {
-        *dst = *src;
-        dst++;
-        *dst = ~(*src);
-        dst++;
-        src++;
-    }
+#if MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_DMA
+    dma_start();
+#elif MIDEA_IR_TX_ENGINE == MIDEA_IR_TX_PWM
+    pwm_start();
+#else
+    isr_start();
+#endif
 }
 
 static inline void send_ir_data(const uint8_t data[RAW_DATA_PACKET_SIZE],
                                 const uint8_t repeat)
 {
+#ifdef MIDEA_IR_STREAM_ENCODER
+    for (uint8_t b = 0; b < RAW_DATA_PACKET_SIZE; b++)
+    {
+        ir_state.data[b] = data[b];
+    }
+#else
     init_buff();
     add_start();
 
@@ -299,25 +925,146 @@ static inline void send_ir_data(const uint8_t data[RAW_DATA_PACKET_SIZE],
     }
 
     add_stop();
+#endif
     start(repeat);
 }
 
-void midea_ir_send(MideaIR *ir)
+/**
+ * Transmit queue.
+ *
+ * Frames are sent one after the other from the completion of the previous
+ * one, so a send never disturbs a frame in progress and never blocks.
+ * A new state frame replaces a state frame that is still waiting: only
+ * the latest state of the air conditioner matters, so rapid changes cost
+ * a single frame. Deflector moves are never merged, each one is a step
+ * of the deflector; a frame that finds the queue full is rejected.
+ *
+ * With MIDEA_IR_PREEMPT the state frame being sent is given up too: the
+ * engine ends it (and its repeat) after the next space pulse, so the
+ * start condition of the newer frame never merges into a mark. A
+ * truncated frame fails the inverted byte check of the receiver.
+ */
+
+#define TX_QUEUE_SIZE 4
+
+typedef struct
 {
-    DataPacket packet;
-    pack_data(ir, &packet);
     uint8_t data[RAW_DATA_PACKET_SIZE];
-    add_complementary_bytes((uint8_t *)&packet, data);
+    uint8_t repeat;
+    bool state; // carries an air conditioner state, newer state replaces it
+} IrFrame;
+
+static IrFrame tx_queue[TX_QUEUE_SIZE];
+static volatile uint8_t tx_head;  // oldest waiting frame
+static volatile uint8_t tx_count; // waiting frames
+static volatile bool tx_busy;     // frame is being sent
+#ifdef MIDEA_IR_PREEMPT
+static bool tx_sending_state;     // frame being sent is a state frame
+#endif
+
+__weak void midea_ir_sent_callback(void)
+{
+}
+
+static void frame_done(void)
+{
+#ifdef MIDEA_IR_PREEMPT
+    tx_abort = false;
+#endif
+#ifdef MIDEA_IR_ISR_LATENCY
+    latency_frame = latency_run;
+    latency_run = (MideaIRLatency){0};
+#endif
+    midea_ir_sent_callback();
+
+    if (!tx_count)
+    {
+        tx_busy = false;
+        return;
+    }
 
-    send_ir_data(data, 2);
+    const IrFrame *frame = &tx_queue[tx_head];
+    tx_head = (tx_head + 1) % TX_QUEUE_SIZE;
+    tx_count--;
+#ifdef MIDEA_IR_PREEMPT
+    tx_sending_state = frame->state;
+#endif
+    send_ir_data(frame->data, frame->repeat);
 }
 
-void midea_ir_move_deflector(MideaIR *ir)
+static bool enqueue(const uint8_t data[RAW_DATA_PACKET_SIZE], uint8_t repeat,
+                    bool state)
 {
-    uint8_t data[RAW_DATA_PACKET_SIZE / 2] = {0xB2, 0x0F, 0xE0};
-    uint8_t raw_data[RAW_DATA_PACKET_SIZE];
+    IrFrame *frame;
 
-    add_complementary_bytes(data, raw_data);
+    __disable_irq();
+    if (!tx_busy)
+    { // idle, the frame goes out right away
+        tx_busy = true;
+#ifdef MIDEA_IR_PREEMPT
+        tx_sending_state = state;
+#endif
+        __enable_irq();
+        send_ir_data(data, repeat);
+        return true;
+    }
+
+    uint8_t last = (tx_head + tx_count + TX_QUEUE_SIZE - 1) % TX_QUEUE_SIZE;
+    if (tx_count && state && tx_queue[last].state)
+    { // replaces the newest waiting state
+        frame = &tx_queue[last];
+    }
+    else if (tx_count < TX_QUEUE_SIZE)
+    {
+        frame = &tx_queue[(tx_head + tx_count) % TX_QUEUE_SIZE];
+        tx_count++;
+    }
+    else
+    { // full, the waiting frames are not given up for this one
+        __enable_irq();
+        return false;
+    }
 
-    send_ir_data(raw_data, 1);
-}
\ No newline at end of file
+    for (uint8_t i = 0; i < RAW_DATA_PACKET_SIZE; i++)
+    {
+        frame->data[i] = data[i];
+    }
+    frame->repeat = repeat;
+    frame->state = state;
+#ifdef MIDEA_IR_PREEMPT
+    if (state && tx_sending_state)
+    { // the state being sent is already stale
+        tx_abort = true;
+    }
+#endif
+    __enable_irq();
+    return true;
+}
+
+bool midea_ir_busy(void)
+{
+    return tx_busy;
+}
+
+bool midea_ir_send(MideaIR *ir)
+{
+    const uint8_t *data = off_frame;
+
+    if (ir->enabled)
+    {
+        uint8_t temp = TEMP_DEFAULT;
+        if (ir->temperature >= TEMP_LOW && ir->temperature <= TEMP_HIGH)
+        {
+            temp = ir->temperature - TEMP_LOW;
+        }
+        uint8_t fan = ir->fan_level < FAN_COUNT ? ir->fan_level : FAN_DEFAULT;
+        data = state_frames[ir->mode >> 2][fan][temp];
+    }
+
+    return enqueue(data, 2, true);
+}
+
+bool midea_ir_move_deflector(MideaIR *ir)
+{
+    return enqueue(deflector_frame, 1, false);
+}
@@ -0,0 +1,177 @@
+#include "scheduler.h"
+#include "main.h"
+#include <stdio.h>
+#ifdef SCHEDULER_TICKLESS
+#include "tickless.h"
+#endif
+#ifdef CPU_TIME
+#include "cpu_time.h"
+#endif
+
+static SchedulerTask *tasks;    // registered tasks, in order of registration
+static volatile bool post_seen; // a task was posted since the last scan
+
+uint32_t scheduler_cycles(void)
+{
+#ifdef SCHEDULER_TICKLESS
+    return tickless_cycles();
+#else
+    uint32_t tick;
+    uint32_t val;
+    uint32_t pending;
+
+    do
+    {
+        tick = uwTick;
+        val = SysTick->VAL;
+        pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+        if (pending)
+        { // the period ended, its interrupt is held back: count it, from the reloaded value
+            val = SysTick->VAL;
+        }
+    } while (tick != uwTick);
+
+    return (tick + pending) * (SysTick->LOAD + 1) + (SysTick->LOAD - val);
+#endif
+}
+
+static bool is_due(const SchedulerTask *task, uint32_t now)
+{
+    return (int32_t)(now - task->due) >= 0;
+}
+
+static void run_task(SchedulerTask *task)
+{
+    uint32_t start = scheduler_cycles();
+
+    task->run();
+
+    uint32_t cycles = scheduler_cycles() - start;
+    if (cycles > task->max_cycles)
+    {
+        task->max_cycles = cycles;
+    }
+    task->runs++;
+}
+
+void scheduler_add(SchedulerTask *task, uint32_t delay)
+{
+    SchedulerTask **link = &tasks;
+
+    while (*link && *link != task)
+    {
+        link = &(*link)->next;
+    }
+    if (!*link)
+    {
+        task->next = NULL;
+        *link = task;
+    }
+
+    task->due = HAL_GetTick() + delay;
+    task->armed = true;
+}
+
+void scheduler_post(SchedulerTask *task)
+{
+    task->posted = true;
+    post_seen = true;
+}
+
+void scheduler_cancel(SchedulerTask *task)
+{
+    task->armed = false;
+    task->posted = false;
+}
+
+void scheduler_disarm(SchedulerTask *task)
+{
+    task->armed = false;
+}
+
+__weak void scheduler_idle(void)
+{
+    __WFI();
+}
+
+void scheduler_run(void)
+{
+    while (1)
+    {
+        uint32_t now = HAL_GetTick();
+        bool ran = false;
+#ifdef SCHEDULER_TICKLESS
+        uint32_t sleep = UINT32_MAX; // ms to the nearest deadline
+#endif
+
+        post_seen = false;
+        for (SchedulerTask *task = tasks; task; task = task->next)
+        {
+            if (task->posted)
+            {
+                task->posted = false;
+            }
+            else if (task->armed && is_due(task, now))
+            {
+                if (!task->period)
+                {
+                    task->armed = false;
+                }
+                else
+                {
+                    task->due += task->period;
+                    if (is_due(task, now))
+                    { // missed a whole period, skip it rather than catch up
+                        task->overruns++;
+                        task->due = now + task->period;
+                    }
+                }
+            }
+            else
+            {
+#ifdef SCHEDULER_TICKLESS
+                if (task->armed && task->due - now < sleep)
+                {
+                    sleep = task->due - now;
+                }
+#endif
+                continue;
+            }
+
+            run_task(task);
+            ran = true;
+        }
+
+        if (!ran)
+        {
+            __disable_irq();
+            if (!post_seen && now == HAL_GetTick())
+            {
+#ifdef CPU_TIME
+                CpuTimer timer;
+                cpu_time_start(&timer);
+#endif
+#ifdef SCHEDULER_TICKLESS
+                tickless_prepare(sleep);
+#endif
+                scheduler_idle();
+#ifdef CPU_TIME
+                cpu_time_stop(&timer, CPU_IDLE);
+#endif
+            }
+            __enable_irq();
+        }
+    }
+}
+
+void scheduler_report(void)
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    for (SchedulerTask *task = tasks; task; task = task->next)
+    {
+        printf("%-8s %lu runs, %lu us max, %lu overruns\r\n", task->name,
+               task->runs, task->max_cycles / cycles_per_us, task->overruns);
+        task->max_cycles = 0;
+    }
+}
@@ -0,0 +1,221 @@
+#include "spi_bus.h"
+#include "spi.h"
+
+#define NSS_PORT DISP_LAT_GPIO_Port
+#define NSS_PIN  DISP_LAT_Pin
+#define NSS_MODE GPIO_MODER_MODER4 // of DISP_LAT
+#define NSS_MODE_OUTPUT GPIO_MODER_MODER4_0
+#define NSS_MODE_AF     GPIO_MODER_MODER4_1
+
+static SpiTransfer *head; // queue, head is on the wire
+static SpiTransfer *tail;
+static const SpiDevice *configured;
+static const SpiStream *stream;
+static bool streaming; // stream started and not stopped
+static bool completing; // in transfer_done(), which starts the next one
+
+static void transfer_done(void);
+
+static uint32_t prescaler(const SpiDevice *device)
+{
+    uint32_t br = 0;
+
+    while ((SystemCoreClock >> (br + 1)) > device->max_hz && br < 7)
+    {
+        br++;
+    }
+    return br << SPI_CR1_BR_Pos;
+}
+
+static void park_nss(bool parked)
+{
+    NSS_PORT->BSRR = NSS_PIN;
+    MODIFY_REG(NSS_PORT->MODER, NSS_MODE,
+               parked ? NSS_MODE_OUTPUT : NSS_MODE_AF);
+}
+
+// SPI1 is disabled here, it is enabled again by the next transmission
+static void configure(const SpiDevice *device)
+{
+    bool hardware_nss = device->cs_port == NULL;
+    bool byte_frames = device->data_size <= SPI_DATASIZE_8BIT;
+
+    __HAL_SPI_DISABLE(&hspi1);
+    hspi1.Init.DataSize = device->data_size;
+    hspi1.Init.BaudRatePrescaler = prescaler(device);
+    hspi1.Init.NSS = hardware_nss ? SPI_NSS_HARD_OUTPUT : SPI_NSS_SOFT;
+    hspi1.Init.NSSPMode = hardware_nss ? SPI_NSS_PULSE_ENABLE : SPI_NSS_PULSE_DISABLE;
+
+    MODIFY_REG(hspi1.Instance->CR1, SPI_CR1_BR | SPI_CR1_SSM | SPI_CR1_SSI,
+               hspi1.Init.BaudRatePrescaler | (hardware_nss ? 0 : SPI_CR1_SSM | SPI_CR1_SSI));
+    MODIFY_REG(hspi1.Instance->CR2, SPI_CR2_DS | SPI_CR2_FRXTH | SPI_CR2_SSOE | SPI_CR2_NSSP,
+               device->data_size | (byte_frames ? SPI_CR2_FRXTH : 0) |
+               (hardware_nss ? SPI_CR2_SSOE | SPI_CR2_NSSP : 0));
+    park_nss(!hardware_nss);
+    configured = device;
+}
+
+static void stop_stream(void)
+{
+    stream->stop();
+    streaming = false;
+    while (hspi1.Instance->SR & SPI_SR_BSY)
+    {
+    }
+}
+
+// Called with interrupts disabled or from the DMA interrupt, head is free
+// and not in a completion
+static void start_next(void)
+{
+    SpiTransfer *transfer = head;
+
+    if (!transfer)
+    {
+        if (stream && !streaming)
+        {
+            if (configured != stream->device)
+            {
+                configure(stream->device);
+            }
+            streaming = true;
+            stream->start();
+        }
+        return;
+    }
+
+    if (configured != transfer->device)
+    {
+        configure(transfer->device);
+    }
+    if (transfer->device->cs_port)
+    {
+        transfer->device->cs_port->BRR = transfer->device->cs_pin;
+    }
+    switch (HAL_SPI_Transmit_DMA(&hspi1, (uint8_t *)transfer->data, transfer->count))
+    {
+    case HAL_OK:
+        break;
+    case HAL_BUSY:
+        // a transfer is still on the wire, its completion starts this one
+        break;
+    default:
+        // dropped, the queue goes on
+        transfer_done();
+        break;
+    }
+}
+
+bool spi_bus_submit(SpiTransfer *transfer)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (transfer->queued)
+    {
+        __set_PRIMASK(primask);
+        return false;
+    }
+    transfer->queued = true;
+    transfer->next = NULL;
+    if (tail)
+    {
+        tail->next = transfer;
+        tail = transfer;
+    }
+    else
+    {
+        head = tail = transfer;
+        if (!completing)
+        {
+            if (streaming)
+            {
+                stop_stream();
+            }
+            start_next();
+        }
+    }
+    __set_PRIMASK(primask);
+
+    return true;
+}
+
+void spi_bus_stream(const SpiStream *next)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (streaming && next != stream)
+    {
+        stop_stream();
+    }
+    stream = next;
+    if (!head && !completing)
+    {
+        start_next();
+    }
+    __set_PRIMASK(primask);
+}
+
+bool spi_bus_idle(void)
+{
+    return head == NULL;
+}
+
+void spi_bus_clock_changed(void)
+{
+    if (!configured)
+    {
+        return;
+    }
+
+    bool enabled = hspi1.Instance->CR1 & SPI_CR1_SPE;
+
+    hspi1.Init.BaudRatePrescaler = prescaler(configured);
+    __HAL_SPI_DISABLE(&hspi1);
+    MODIFY_REG(hspi1.Instance->CR1, SPI_CR1_BR, hspi1.Init.BaudRatePrescaler);
+    if (enabled)
+    { // a stream writes the data register directly
+        __HAL_SPI_ENABLE(&hspi1);
+    }
+}
+
+static void transfer_done(void)
+{
+    SpiTransfer *transfer = head;
+
+    if (transfer->device->cs_port)
+    {
+        transfer->device->cs_port->BSRR = transfer->device->cs_pin;
+    }
+    head = transfer->next;
+    if (!head)
+    {
+        tail = NULL;
+    }
+    transfer->queued = false;
+    if (transfer->done)
+    { // submit and stream only queue from here, the bus is started below
+        completing = true;
+        transfer->done(transfer);
+        completing = false;
+    }
+    start_next();
+}
+
+// The HAL calls these once the last frame has left the shift register
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi == &hspi1)
+    {
+        transfer_done();
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    if (hspi == &hspi1)
+    { // dropped, the queue goes on
+        transfer_done();
+    }
+}
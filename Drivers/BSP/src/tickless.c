@@ -0,0 +1,234 @@
+#include "tickless.h"
+#include "main.h"
+
+#ifdef SCHEDULER_TICKLESS
+
+/**
+ * The SysTick counter is never stopped. A new LOAD only takes effect at
+ * the next reload, so stretching a period is done ahead: the running
+ * millisecond ends on time and the long period follows it without a
+ * cycle lost. The interrupt adds the length of the period that ended.
+ *
+ * Millisecond boundaries are counted back from the end of the running
+ * period: HAL_GetTick() is the tick at the end minus the milliseconds
+ * still left on the counter.
+ *
+ * An interrupt other than SysTick, the button say, can wake the board
+ * early and a task can then ask for an earlier deadline. The running
+ * period is then cut at the next millisecond boundary by reloading the
+ * counter, sync_cycles being the cycles between reading the counter and
+ * its reload. This is the only step that can drift, by the error of
+ * sync_cycles, once per cut.
+ *
+ * sync_cycles depends on the flash wait states and the code the compiler
+ * made of reload(), so it is measured by HAL_InitTick() on every clock
+ * change: TIM14 counts core cycles next to SysTick, and the sum of both
+ * counters only stays the same across reload() when sync_cycles is
+ * right. The measurement itself shifts the time base once, by the error
+ * of the previous sync_cycles.
+ */
+
+#define TICKLESS_MIN_MS 2   // shorter sleeps keep the 1ms period
+#define SETTLE_CYCLES   512 // counter left for the bookkeeping before a reload
+
+static uint32_t tick_cycles;            // core cycles in a millisecond
+static uint32_t tick_max_ms;            // longest period the counter holds
+static volatile uint32_t tick_step = 1; // ms at the end of the running period
+static volatile uint32_t next_step = 1; // ms of the period after the next reload
+static uint32_t sync_cycles;            // from reading VAL in reload() to the reload
+
+static uint32_t settle(void);
+
+/**
+ * Reload the counter now, so that its period ends stop cycles before the
+ * end of the running one, and continue with next_load. Not inlined: the
+ * cut and the measurement must run the very same instructions.
+ */
+__attribute__((noinline)) static void reload(uint32_t stop, uint32_t next_load)
+{
+    uint32_t val = SysTick->VAL;
+    SysTick->LOAD = val - stop - sync_cycles;
+    SysTick->VAL = 0; // reloads on the next cycle
+    SysTick->LOAD = next_load;
+}
+
+// SysTick counter and TIM14 counter read back to back, the same way twice
+__attribute__((noinline)) static uint32_t counters(uint16_t *cnt)
+{
+    uint32_t val = SysTick->VAL;
+    *cnt = TIM14->CNT;
+    return val;
+}
+
+/**
+ * Measure sync_cycles with a reload() that ends the period where it
+ * would end anyway (stop 0). Between two samples SysTick counts down
+ * what TIM14 counts up, so the change of their sum is the cycles the
+ * reload added to the period, sync_cycles too few.
+ */
+static void calibrate(void)
+{
+    bool clock_on = __HAL_RCC_TIM14_IS_CLK_ENABLED();
+    uint16_t cnt_before;
+    uint16_t cnt_after;
+
+    __HAL_RCC_TIM14_CLK_ENABLE();
+    TIM14->PSC = 0;
+    TIM14->ARR = 0xFFFF;
+    TIM14->CR1 = TIM_CR1_CEN; // runs from the core clock, APB1 is not divided
+
+    settle();
+    uint32_t val_before = counters(&cnt_before);
+    reload(0, tick_cycles - 1);
+    uint32_t val_after = counters(&cnt_after);
+    sync_cycles += (val_after - val_before) + (uint16_t)(cnt_after - cnt_before);
+
+    TIM14->CR1 = 0;
+    if (!clock_on)
+    {
+        __HAL_RCC_TIM14_CLK_DISABLE();
+    }
+}
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    uint32_t primask = __get_PRIMASK();
+    HAL_StatusTypeDef status = HAL_OK;
+
+    __disable_irq();
+    if (tick_cycles)
+    { // keep the milliseconds of a stretched period, the fraction is lost
+        uwTick = HAL_GetTick();
+        SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+    }
+    tick_step = 1;
+    next_step = 1;
+    tick_cycles = SystemCoreClock / 1000U;
+    tick_max_ms = (SysTick_LOAD_RELOAD_Msk + 1) / tick_cycles;
+
+    if (HAL_SYSTICK_Config(tick_cycles) > 0U || TickPriority >= (1UL << __NVIC_PRIO_BITS))
+    {
+        status = HAL_ERROR;
+    }
+    else
+    {
+        HAL_NVIC_SetPriority(SysTick_IRQn, TickPriority, 0U);
+        uwTickPrio = TickPriority;
+        calibrate();
+    }
+    __set_PRIMASK(primask);
+
+    return status;
+}
+
+void HAL_IncTick(void)
+{
+    uwTick += tick_step;
+    tick_step = next_step;
+    next_step = 1;
+    SysTick->LOAD = tick_cycles - 1;
+}
+
+// HAL tick at the end of the running period, and the cycles left to it
+static uint32_t period_end(uint32_t *left)
+{
+    uint32_t tick;
+    uint32_t end;
+
+    do
+    {
+        tick = uwTick;
+        end = tick + tick_step;
+        *left = SysTick->VAL + 1;
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+        { // the period ended, its interrupt is held back
+            *left = 0;
+        }
+    } while (tick != uwTick);
+
+    return end;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    uint32_t left;
+    uint32_t end = period_end(&left);
+
+    return end - (left + tick_cycles - 1) / tick_cycles;
+}
+
+uint32_t tickless_cycles(void)
+{
+    uint32_t left;
+    uint32_t end = period_end(&left);
+
+    return end * tick_cycles - left;
+}
+
+/**
+ * Take a reload whose interrupt is held back by the disabled interrupts
+ * here, and wait out a reload that is too close. Returns the cycles
+ * left in the running period, at least SETTLE_CYCLES.
+ */
+static uint32_t settle(void)
+{
+    uint32_t val;
+
+    do
+    {
+        val = SysTick->VAL;
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+        {
+            SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+            HAL_IncTick();
+            val = 0;
+        }
+    } while (val < SETTLE_CYCLES);
+
+    return val + 1;
+}
+
+// End the running period at the next millisecond boundary, or the one
+// after if the next is too close to hit.
+static void cut(uint32_t left)
+{
+    uint32_t ms_after = (left - 1) / tick_cycles; // whole ms after the running one
+    uint32_t stop = ms_after * tick_cycles;       // cycles left at the boundary
+
+    uwTick += tick_step - ms_after - 1;
+    tick_step = 1;
+    if (left - stop < SETTLE_CYCLES)
+    {
+        stop -= tick_cycles;
+        tick_step = 2;
+    }
+
+    reload(stop, tick_cycles - 1);
+}
+
+void tickless_prepare(uint32_t sleep_ms)
+{
+    uint32_t left = settle();
+    uint32_t ahead = (left - 1) / tick_cycles + 1; // ms to the end of the period
+    uint32_t ms;
+
+    if (ahead > sleep_ms && ahead > 1)
+    {
+        cut(left);
+        ahead = tick_step;
+    }
+
+    ms = sleep_ms > ahead ? sleep_ms - ahead : 0;
+    if (ms < TICKLESS_MIN_MS)
+    {
+        ms = 1;
+    }
+    else if (ms > tick_max_ms)
+    {
+        ms = tick_max_ms;
+    }
+    SysTick->LOAD = ms * tick_cycles - 1;
+    next_step = ms;
+}
+
+#endif /* SCHEDULER_TICKLESS */
@@ -0,0 +1,34 @@
+#ifndef __CHECK_H__
+#define __CHECK_H__
+
+#include <stdio.h>
+
+/**
+ * Checks of the host tests: a failed one is printed and counted, the
+ * test goes on. main() returns check_result().
+ */
+
+extern int check_failures;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+            check_failures++; \
+        } \
+    } while (0)
+
+static inline int check_result(void)
+{
+    if (check_failures)
+    {
+        printf("%d failures\n", check_failures);
+        return 1;
+    }
+    printf("ok\n");
+    return 0;
+}
+
+#endif /* __CHECK_H__ */
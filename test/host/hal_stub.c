@@ -0,0 +1,314 @@
+#include "hal_stub.h"
+#include "tim.h"
+#include "spi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint32_t SystemCoreClock = 32000000;
+__IO uint32_t uwTick;
+uint32_t uwTickPrio = (1UL << __NVIC_PRIO_BITS);
+HAL_TickFreqTypeDef uwTickFreq = HAL_TICK_FREQ_DEFAULT;
+
+TIM_HandleTypeDef htim1;
+TIM_HandleTypeDef htim16;
+DMA_HandleTypeDef hdma_tim1_up;
+DMA_HandleTypeDef hdma_tim16_up;
+SPI_HandleTypeDef hspi1;
+DMA_HandleTypeDef hdma_spi1_tx;
+
+static HostSpiFrame spi_log[HOST_SPI_LOG_SIZE];
+static uint32_t spi_count;
+
+// TIM_Base_SetConfig() of the HAL, the update event latches PSC and ARR
+static void base_init(TIM_HandleTypeDef *htim)
+{
+    TIM_TypeDef *tim = htim->Instance;
+
+    tim->CR1 = htim->Init.AutoReloadPreload | htim->Init.CounterMode;
+    tim->ARR = htim->Init.Period;
+    tim->PSC = htim->Init.Prescaler;
+    tim->RCR = htim->Init.RepetitionCounter;
+    tim->EGR = TIM_EGR_UG;
+    host_flush();
+    tim->SR = ~TIM_SR_UIF;
+    host_flush();
+    htim->State = HAL_TIM_STATE_READY;
+}
+
+void host_init(void)
+{
+    host_reset();
+    uwTick = 0;
+    spi_count = 0;
+    SystemCoreClock = 32000000;
+
+    // MX_TIM1_Init(): 76kHz update of the IR engine
+    memset(&htim1, 0, sizeof(htim1));
+    htim1.Instance = TIM1;
+    htim1.Init.Prescaler = 0;
+    htim1.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim1.Init.Period = 421;
+    htim1.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    htim1.hdma[TIM_DMA_ID_UPDATE] = &hdma_tim1_up;
+    base_init(&htim1);
+
+    // MX_TIM16_Init(): 4kHz display brightness PWM
+    memset(&htim16, 0, sizeof(htim16));
+    htim16.Instance = TIM16;
+    htim16.Init.Prescaler = 31;
+    htim16.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim16.Init.Period = 249;
+    htim16.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    htim16.hdma[TIM_DMA_ID_UPDATE] = &hdma_tim16_up;
+    base_init(&htim16);
+
+    // MX_SPI1_Init(): 16 bit master, hardware NSS pulse
+    memset(&hspi1, 0, sizeof(hspi1));
+    hspi1.Instance = SPI1;
+    hspi1.Init.Mode = SPI_MODE_MASTER;
+    hspi1.Init.DataSize = SPI_DATASIZE_16BIT;
+    hspi1.Init.NSS = SPI_NSS_HARD_OUTPUT;
+    hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_128;
+    hspi1.Init.NSSPMode = SPI_NSS_PULSE_ENABLE;
+    hspi1.hdmatx = &hdma_spi1_tx;
+    hspi1.Instance->CR1 = SPI_CR1_MSTR | hspi1.Init.BaudRatePrescaler;
+    hspi1.Instance->CR2 = SPI_DATASIZE_16BIT | SPI_CR2_SSOE | SPI_CR2_NSSP;
+    hspi1.Instance->SR = SPI_SR_TXE; // nothing is shifted out in the model
+    hspi1.State = HAL_SPI_STATE_READY;
+}
+
+uint32_t host_spi_count(void)
+{
+    return spi_count;
+}
+
+const HostSpiFrame *host_spi_frames(void)
+{
+    return spi_log;
+}
+
+bool host_spi_dma_complete(void)
+{
+    if (hspi1.State != HAL_SPI_STATE_BUSY_TX)
+    {
+        return false;
+    }
+    hspi1.State = HAL_SPI_STATE_READY;
+    HAL_SPI_TxCpltCallback(&hspi1);
+    return true;
+}
+
+/* GPIO */
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+    if (PinState != GPIO_PIN_RESET)
+    {
+        GPIOx->BSRR = GPIO_Pin;
+    }
+    else
+    {
+        GPIOx->BRR = GPIO_Pin;
+    }
+    host_flush();
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+    return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+/* TIM */
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->CR1 |= TIM_CR1_CEN;
+    host_flush();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->CR1 &= ~TIM_CR1_CEN;
+    host_flush();
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->DIER |= TIM_DIER_UIE;
+    return HAL_TIM_Base_Start(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef *htim)
+{
+    htim->Instance->DIER &= ~TIM_DIER_UIE;
+    return HAL_TIM_Base_Stop(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_ConfigChannel(TIM_HandleTypeDef *htim,
+                                            const TIM_OC_InitTypeDef *sConfig,
+                                            uint32_t Channel)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Start(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    return HAL_TIM_Base_Start(htim);
+}
+
+HAL_StatusTypeDef HAL_TIM_PWM_Stop(TIM_HandleTypeDef *htim, uint32_t Channel)
+{
+    return HAL_TIM_Base_Stop(htim);
+}
+
+/* DMA */
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress,
+                                uint32_t DstAddress, uint32_t DataLength)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start_IT(DMA_HandleTypeDef *hdma, uint32_t SrcAddress,
+                                   uint32_t DstAddress, uint32_t DataLength)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+    return HAL_OK;
+}
+
+/* SPI */
+
+static void spi_log_frames(const uint8_t *data, uint16_t size)
+{
+    bool words = hspi1.Instance->CR2 & SPI_CR2_DS_3; // 9 bits and more
+
+    for (uint16_t i = 0; i < size; i++)
+    {
+        if (spi_count == HOST_SPI_LOG_SIZE)
+        {
+            fprintf(stderr, "host: SPI log is full\n");
+            abort();
+        }
+
+        HostSpiFrame *frame = &spi_log[spi_count++];
+        frame->cycle = host_now;
+        frame->frame = words ? ((const uint16_t *)data)[i] : data[i];
+        frame->cr1 = hspi1.Instance->CR1;
+        frame->cr2 = hspi1.Instance->CR2;
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData,
+                                   uint16_t Size, uint32_t Timeout)
+{
+    if (hspi->State != HAL_SPI_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+    hspi->Instance->CR1 |= SPI_CR1_SPE;
+    spi_log_frames(pData, Size);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData,
+                                       uint16_t Size)
+{
+    if (hspi->State != HAL_SPI_STATE_READY)
+    {
+        return HAL_BUSY;
+    }
+    hspi->State = HAL_SPI_STATE_BUSY_TX;
+    hspi->Instance->CR1 |= SPI_CR1_SPE;
+    spi_log_frames(pData, Size);
+    return HAL_OK;
+}
+
+__weak void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+}
+
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+}
+
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi)
+{
+    return hspi->State;
+}
+
+/* Cortex */
+
+uint32_t HAL_SYSTICK_Config(uint32_t TicksNumb)
+{
+    if (TicksNumb - 1 > SysTick_LOAD_RELOAD_Msk)
+    {
+        return 1;
+    }
+    SysTick->LOAD = TicksNumb - 1;
+    SysTick->VAL = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk |
+                    SysTick_CTRL_ENABLE_Msk;
+    host_flush();
+    return 0;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+}
+
+/* Time base, overridden by tickless.c like on the target */
+
+__weak HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+    if (HAL_SYSTICK_Config(SystemCoreClock / (1000U / uwTickFreq)))
+    {
+        return HAL_ERROR;
+    }
+    uwTickPrio = TickPriority;
+    return HAL_OK;
+}
+
+__weak void HAL_IncTick(void)
+{
+    uwTick += uwTickFreq;
+}
+
+__weak uint32_t HAL_GetTick(void)
+{
+    return uwTick;
+}
+
+__weak void HAL_Delay(uint32_t Delay)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (HAL_GetTick() - start < Delay)
+    {
+        host_wfi();
+    }
+}
+
+void Error_Handler(void)
+{
+    fprintf(stderr, "host: Error_Handler()\n");
+    abort();
+}
@@ -0,0 +1,45 @@
+#ifndef __HAL_STUB_H__
+#define __HAL_STUB_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "main.h"
+
+/**
+ * HAL calls of the BSP, done on the model of host.c.
+ *
+ * The timer and GPIO calls write the registers like the HAL does. DMA
+ * is not modelled: HAL_SPI_Transmit_DMA() records the frames and leaves
+ * the handle busy until the test completes the transfer with
+ * host_spi_dma_complete(), which calls the HAL callback like the DMA
+ * interrupt does.
+ */
+
+#define HOST_SPI_LOG_SIZE 1024
+
+typedef struct {
+    uint64_t cycle;    // host_now when the transfer was started
+    uint16_t frame;    // 8 or 16 bit frame
+    uint32_t cr1;      // SPI1 CR1 and CR2 at the start, prescaler and NSS mode
+    uint32_t cr2;
+} HostSpiFrame;
+
+/**
+ * Reset the model and set up the peripherals like the MX_*_Init()
+ * functions of the firmware.
+ */
+void host_init(void);
+
+/**
+ * Frames started by HAL_SPI_Transmit_DMA() since host_init(), oldest first
+ */
+uint32_t host_spi_count(void);
+const HostSpiFrame *host_spi_frames(void);
+
+/**
+ * End the DMA transfer on SPI1, false if none is running
+ */
+bool host_spi_dma_complete(void);
+
+#endif /* __HAL_STUB_H__ */
@@ -0,0 +1,504 @@
+#include "main.h"
+#include "host.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t host_now;
+
+#define NEVER UINT64_MAX
+
+typedef struct
+{
+    TIM_TypeDef regs;
+    uint32_t cnt;
+    uint32_t sr;
+    uint32_t arr;        // active auto-reload, ARR goes through it with ARPE
+    uint32_t cnt_shadow; // CNT and SR as last published, a difference is a write
+    uint32_t sr_shadow;
+} Timer;
+
+typedef struct
+{
+    GPIO_TypeDef regs;
+    uint32_t odr;
+} Port;
+
+static Timer tim1;
+static Timer tim14;
+static TIM_TypeDef tim16;
+static SPI_TypeDef spi1;
+static RCC_TypeDef rcc;
+static Port gpioa;
+static Port gpiob;
+
+static SysTick_Type systick;
+static uint32_t systick_val;
+static uint32_t systick_val_shadow;
+static bool systick_pending;
+static SCB_Type scb;
+static uint32_t icsr_shadow;
+
+static uint32_t primask;
+static bool in_handler;
+static uint32_t handlers_taken;
+static uint64_t external_at = NEVER;
+static void (*external_handler)(void);
+static bool external_pending;
+
+__attribute__((weak)) void SysTick_Handler(void)
+{
+    HAL_IncTick();
+}
+
+__attribute__((weak)) void TIM1_BRK_UP_TRG_COM_IRQHandler(void)
+{
+    TIM1->SR = ~TIM_SR_UIF;
+}
+
+/* Writes */
+
+static void timer_apply(Timer *t)
+{
+    if (t->regs.CNT != t->cnt_shadow)
+    {
+        t->cnt = t->regs.CNT & 0xFFFF;
+    }
+    if (t->regs.SR != t->sr_shadow)
+    { // rc_w0, writing 1 leaves a flag as it is
+        t->sr &= t->regs.SR;
+    }
+    if (t->regs.EGR & TIM_EGR_UG)
+    {
+        t->cnt = 0;
+        t->arr = t->regs.ARR & 0xFFFF;
+        if (!(t->regs.CR1 & TIM_CR1_URS))
+        {
+            t->sr |= TIM_SR_UIF;
+        }
+    }
+    t->regs.EGR = 0;
+    if (!(t->regs.CR1 & TIM_CR1_ARPE))
+    {
+        t->arr = t->regs.ARR & 0xFFFF;
+    }
+}
+
+static void port_apply(Port *p)
+{
+    uint32_t odr = p->odr;
+
+    if (p->regs.ODR != p->odr)
+    {
+        odr = p->regs.ODR & 0xFFFF;
+    }
+    odr &= ~p->regs.BRR;
+    odr &= ~(p->regs.BSRR >> 16);
+    odr |= p->regs.BSRR & 0xFFFF; // set wins over reset
+    p->regs.BSRR = 0;
+    p->regs.BRR = 0;
+
+    uint32_t changed = (odr ^ p->odr) & 0xFFFF;
+    p->odr = odr;
+    p->regs.ODR = odr;
+    for (uint16_t pin = 1; changed; pin <<= 1)
+    {
+        if (changed & pin)
+        {
+            host_pin_changed(&p->regs, pin, odr & pin);
+            changed &= ~pin;
+        }
+    }
+}
+
+static void apply_writes(void)
+{
+    timer_apply(&tim1);
+    timer_apply(&tim14);
+    port_apply(&gpioa);
+    port_apply(&gpiob);
+
+    if (systick.VAL != systick_val_shadow)
+    { // any write clears the counter, it reloads on the next cycle
+        systick_val = 0;
+        systick.CTRL &= ~SysTick_CTRL_COUNTFLAG_Msk;
+    }
+    if (scb.ICSR != icsr_shadow)
+    {
+        if (scb.ICSR & SCB_ICSR_PENDSTCLR_Msk)
+        {
+            systick_pending = false;
+        }
+        if (scb.ICSR & SCB_ICSR_PENDSTSET_Msk)
+        {
+            systick_pending = true;
+        }
+    }
+}
+
+/* Reads */
+
+static void timer_publish(Timer *t)
+{
+    t->regs.CNT = t->cnt;
+    t->regs.SR = t->sr;
+    t->cnt_shadow = t->cnt;
+    t->sr_shadow = t->sr;
+}
+
+static void publish(void)
+{
+    timer_publish(&tim1);
+    timer_publish(&tim14);
+    systick.VAL = systick_val;
+    systick_val_shadow = systick_val;
+    scb.ICSR = systick_pending ? SCB_ICSR_PENDSTSET_Msk : 0;
+    icsr_shadow = scb.ICSR;
+}
+
+/* Time */
+
+static uint64_t systick_to_event(void)
+{
+    uint32_t load = systick.LOAD & SysTick_LOAD_RELOAD_Msk;
+
+    if (!(systick.CTRL & SysTick_CTRL_ENABLE_Msk))
+    {
+        return NEVER;
+    }
+    if (systick_val)
+    {
+        return systick_val;
+    }
+    return load ? 1 + load : NEVER;
+}
+
+static void systick_step(uint64_t n)
+{
+    uint32_t load = systick.LOAD & SysTick_LOAD_RELOAD_Msk;
+
+    if (!(systick.CTRL & SysTick_CTRL_ENABLE_Msk))
+    {
+        return;
+    }
+    while (n)
+    {
+        if (!systick_val)
+        {
+            if (!load)
+            {
+                return;
+            }
+            systick_val = load;
+            n--;
+            continue;
+        }
+
+        uint64_t k = n < systick_val ? n : systick_val;
+        systick_val -= k;
+        n -= k;
+        if (!systick_val)
+        {
+            systick.CTRL |= SysTick_CTRL_COUNTFLAG_Msk;
+            if (systick.CTRL & SysTick_CTRL_TICKINT_Msk)
+            {
+                systick_pending = true;
+            }
+        }
+    }
+}
+
+static uint64_t timer_to_event(const Timer *t)
+{
+    if (!(t->regs.CR1 & TIM_CR1_CEN))
+    {
+        return NEVER;
+    }
+    if (t->cnt > t->arr)
+    { // ARR lowered below the counter, it runs up to 0xFFFF first
+        return 0x10000 - t->cnt + t->arr + 1;
+    }
+    return t->arr - t->cnt + 1;
+}
+
+static void timer_step(Timer *t, uint64_t n)
+{
+    while (n)
+    {
+        uint64_t to_update = timer_to_event(t);
+        if (to_update == NEVER)
+        {
+            return;
+        }
+        if (n < to_update)
+        {
+            t->cnt = (t->cnt + n) & 0xFFFF;
+            return;
+        }
+        n -= to_update;
+        t->cnt = 0;
+        t->sr |= TIM_SR_UIF;
+        if (t->regs.CR1 & TIM_CR1_ARPE)
+        {
+            t->arr = t->regs.ARR & 0xFFFF;
+        }
+    }
+}
+
+// distance to the next event that can raise an interrupt
+static uint64_t next_event(void)
+{
+    uint64_t step = systick_to_event();
+    uint64_t tim1_update = timer_to_event(&tim1);
+
+    if (tim1_update < step)
+    {
+        step = tim1_update;
+    }
+    if (external_handler && external_at != NEVER)
+    {
+        uint64_t external = external_at > host_now ? external_at - host_now : 0;
+        if (external < step)
+        {
+            step = external;
+        }
+    }
+    return step;
+}
+
+static bool irq_pending(void)
+{
+    return systick_pending ||
+           ((tim1.sr & TIM_SR_UIF) && (tim1.regs.DIER & TIM_DIER_UIE)) ||
+           external_pending;
+}
+
+static void take_interrupts(void)
+{
+    if (primask || in_handler)
+    {
+        return;
+    }
+    for (;;)
+    {
+        void (*handler)(void) = NULL;
+
+        if (systick_pending)
+        { // cleared on exception entry
+            systick_pending = false;
+            handler = SysTick_Handler;
+        }
+        else if ((tim1.sr & TIM_SR_UIF) && (tim1.regs.DIER & TIM_DIER_UIE))
+        {
+            handler = TIM1_BRK_UP_TRG_COM_IRQHandler;
+        }
+        else if (external_pending)
+        {
+            external_pending = false;
+            handler = external_handler;
+        }
+        if (!handler)
+        {
+            return;
+        }
+
+        in_handler = true;
+        handlers_taken++;
+        host_advance(HOST_IRQ_ENTRY_CYCLES);
+        handler();
+        apply_writes();
+        publish();
+        in_handler = false;
+    }
+}
+
+void host_advance(uint64_t cycles)
+{
+    uint64_t end = host_now + cycles;
+
+    apply_writes();
+    publish();
+    take_interrupts();
+    while (host_now < end)
+    {
+        uint64_t step = next_event();
+        if (step == 0 || step > end - host_now)
+        {
+            step = step ? end - host_now : 0;
+        }
+
+        systick_step(step);
+        timer_step(&tim1, step);
+        timer_step(&tim14, step);
+        host_now += step;
+        if (external_handler && external_at != NEVER && host_now >= external_at)
+        {
+            external_at = NEVER;
+            external_pending = true;
+        }
+        publish();
+        take_interrupts();
+    }
+}
+
+bool host_run_until(bool (*done)(void), uint64_t limit)
+{
+    uint64_t end = host_now + limit;
+
+    host_flush();
+    while (!done() && host_now < end)
+    {
+        uint64_t step = next_event();
+        if (step > end - host_now)
+        {
+            step = end - host_now;
+        }
+        host_advance(step ? step : 1);
+    }
+    return done();
+}
+
+void host_flush(void)
+{
+    apply_writes();
+    publish();
+    take_interrupts();
+}
+
+void host_external_irq(uint64_t at, void (*handler)(void))
+{
+    external_at = handler ? at : NEVER;
+    external_handler = handler;
+    external_pending = false;
+}
+
+void host_reset(void)
+{
+    memset(&tim1, 0, sizeof(tim1));
+    memset(&tim14, 0, sizeof(tim14));
+    memset(&tim16, 0, sizeof(tim16));
+    memset(&spi1, 0, sizeof(spi1));
+    memset(&rcc, 0, sizeof(rcc));
+    memset(&gpioa, 0, sizeof(gpioa));
+    memset(&gpiob, 0, sizeof(gpiob));
+    memset(&systick, 0, sizeof(systick));
+    memset(&scb, 0, sizeof(scb));
+
+    tim1.regs.ARR = tim1.arr = 0xFFFF;
+    tim14.regs.ARR = tim14.arr = 0xFFFF;
+    tim16.ARR = 0xFFFF;
+    systick_val = 0;
+    systick_pending = false;
+
+    host_now = 0;
+    primask = 0;
+    in_handler = false;
+    handlers_taken = 0;
+    external_at = NEVER;
+    external_handler = NULL;
+    external_pending = false;
+    publish();
+}
+
+/* Accessors: the access itself takes time */
+
+static void sync(void)
+{
+    host_advance(HOST_ACCESS_CYCLES);
+}
+
+TIM_TypeDef *host_tim1(void)
+{
+    sync();
+    return &tim1.regs;
+}
+
+TIM_TypeDef *host_tim14(void)
+{
+    sync();
+    return &tim14.regs;
+}
+
+TIM_TypeDef *host_tim16(void)
+{
+    sync();
+    return &tim16;
+}
+
+SPI_TypeDef *host_spi1(void)
+{
+    sync();
+    return &spi1;
+}
+
+GPIO_TypeDef *host_gpioa(void)
+{
+    sync();
+    return &gpioa.regs;
+}
+
+GPIO_TypeDef *host_gpiob(void)
+{
+    sync();
+    return &gpiob.regs;
+}
+
+SysTick_Type *host_systick(void)
+{
+    sync();
+    return &systick;
+}
+
+SCB_Type *host_scb(void)
+{
+    sync();
+    return &scb;
+}
+
+RCC_TypeDef *host_rcc(void)
+{
+    sync();
+    return &rcc;
+}
+
+/* Core */
+
+void host_disable_irq(void)
+{
+    primask = 1;
+}
+
+void host_enable_irq(void)
+{
+    primask = 0;
+    host_flush();
+}
+
+uint32_t host_get_primask(void)
+{
+    return primask;
+}
+
+void host_set_primask(uint32_t value)
+{
+    primask = value & 1;
+    host_flush();
+}
+
+void host_wfi(void)
+{
+    uint32_t taken = handlers_taken;
+
+    host_flush();
+    // any pending interrupt wakes the core, PRIMASK only holds off the handler
+    while (!irq_pending() && handlers_taken == taken)
+    {
+        uint64_t step = next_event();
+        if (step == NEVER)
+        {
+            fprintf(stderr, "host: WFI with nothing to wake up the core\n");
+            abort();
+        }
+        host_advance(step ? step : 1);
+    }
+}
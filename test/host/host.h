@@ -0,0 +1,90 @@
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "stm32f0xx.h"
+
+/**
+ * Host model of the STM32F070 peripherals the BSP touches.
+ *
+ * Time is counted in virtual core clock cycles. Firmware code takes no
+ * time by itself, every access to a peripheral costs HOST_ACCESS_CYCLES:
+ * the peripheral macros (TIM1, SysTick, GPIOA, ...) call an accessor,
+ * which applies the writes of the previous access, lets the timers run
+ * and updates the registers read back. So a handler takes a few cycles,
+ * a read of SysTick->VAL sees the counter move, and a pin written by the
+ * TIM1 handler changes a few cycles after the update event.
+ *
+ * Modelled:
+ * - SysTick: counter, reload, interrupt, PENDSTSET/PENDSTCLR in SCB->ICSR
+ * - TIM1, TIM14: up-counting with prescaler 0, ARR preload, UG, the
+ *   update flag and the TIM1 update interrupt
+ * - GPIOA, GPIOB: ODR, BSRR, BRR and IDR, edges go to the recorder
+ * - PRIMASK, WFI and a single external interrupt source for the tests
+ * Everything else (RCC, SPI1, TIM16, ...) is plain memory.
+ *
+ * Interrupts do not nest: one pending while a handler runs is taken
+ * when the handler returns. The handler starts HOST_IRQ_ENTRY_CYCLES
+ * after the interrupt, the exception entry of the Cortex-M0.
+ */
+
+#define HOST_ACCESS_CYCLES 2
+#define HOST_IRQ_ENTRY_CYCLES 16
+
+extern uint64_t host_now; // core cycles since host_reset()
+
+/**
+ * Clear all peripherals and the time, like a reset.
+ */
+void host_reset(void);
+
+/**
+ * Let the time run, taking interrupts when they are enabled.
+ */
+void host_advance(uint64_t cycles);
+
+/**
+ * Run until done() returns true or limit cycles have passed, returns
+ * done().
+ */
+bool host_run_until(bool (*done)(void), uint64_t limit);
+
+/**
+ * Apply the writes of the firmware to the peripherals, without letting
+ * time pass. The HAL stubs call it after they wrote a register.
+ */
+void host_flush(void);
+
+/**
+ * External interrupt at the given time, e.g. a button edge. The handler
+ * runs like any other interrupt, held off by PRIMASK. One at a time, a
+ * new one replaces the previous, a NULL handler cancels it.
+ */
+void host_external_irq(uint64_t at, void (*handler)(void));
+
+// Peripheral accessors, see stub/main.h
+TIM_TypeDef *host_tim1(void);
+TIM_TypeDef *host_tim14(void);
+TIM_TypeDef *host_tim16(void);
+SPI_TypeDef *host_spi1(void);
+GPIO_TypeDef *host_gpioa(void);
+GPIO_TypeDef *host_gpiob(void);
+SysTick_Type *host_systick(void);
+SCB_Type *host_scb(void);
+RCC_TypeDef *host_rcc(void);
+
+// Core intrinsics, see stub/cmsis_compiler.h
+void host_disable_irq(void);
+void host_enable_irq(void);
+uint32_t host_get_primask(void);
+void host_set_primask(uint32_t primask);
+void host_wfi(void);
+
+/**
+ * Called on every change of an output pin, the recorder hooks in here.
+ */
+void host_pin_changed(GPIO_TypeDef *port, uint16_t pin, bool level);
+
+#endif /* __HOST_H__ */
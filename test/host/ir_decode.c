@@ -0,0 +1,114 @@
+#include "ir_decode.h"
+
+#define LOWS_PER_MARK 21
+#define TICKS_PER_PULSE 43
+#define MAX_RUNS 2048
+#define STOP_SPACES 11 // at least, after the stop bit
+
+typedef struct {
+    uint16_t marks;
+    uint32_t spaces; // after the marks
+} Run;
+
+// marks and spaces from the edges, the last spaces end at the idle low
+static const char *runs_of(const RecorderEdge *edges, uint32_t count,
+                           uint32_t tick_cycles, Run *runs, uint32_t *run_count)
+{
+    uint32_t lows = 0;
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (!edges[i].level)
+        {
+            continue;
+        }
+
+        // rising edge: a low is over, the high lasts until the next edge
+        lows++;
+        if (i + 1 == count)
+        {
+            return "LED left high";
+        }
+        uint64_t high = edges[i + 1].cycle - edges[i].cycle;
+        uint32_t ticks = (high + tick_cycles / 2) / tick_cycles;
+        if (i + 2 == count)
+        { // the LED goes idle on the step tick, one before a next pulse
+            ticks++;
+        }
+        else if (ticks > STOP_SPACES * TICKS_PER_PULSE && (ticks - 1) % TICKS_PER_PULSE == 0)
+        { // so does a frame from the queue, it starts on that step tick
+            ticks++;
+        }
+        if (ticks <= 2)
+        {
+            continue; // the burst goes on
+        }
+        if (lows % LOWS_PER_MARK || (ticks - 2) % TICKS_PER_PULSE)
+        {
+            return "pulse is not a whole T";
+        }
+        if (n == MAX_RUNS)
+        {
+            return "too many runs";
+        }
+        runs[n].marks = lows / LOWS_PER_MARK;
+        runs[n].spaces = (ticks - 2) / TICKS_PER_PULSE;
+        n++;
+        lows = 0;
+    }
+    if (lows)
+    {
+        return "burst without a space after it";
+    }
+    *run_count = n;
+    return NULL;
+}
+
+const char *ir_decode(const RecorderEdge *edges, uint32_t count,
+                      uint32_t tick_cycles, IrDecoded *out)
+{
+    static Run runs[MAX_RUNS];
+    uint32_t run_count;
+    const char *error = runs_of(edges, count, tick_cycles, runs, &run_count);
+
+    out->count = 0;
+    if (error)
+    {
+        return error;
+    }
+
+    uint32_t r = 0;
+    while (r < run_count)
+    {
+        if (out->count == IR_DECODE_MAX_FRAMES)
+        {
+            return "too many frames";
+        }
+        if (runs[r].marks != 8 || runs[r].spaces != 8)
+        {
+            return "no start condition";
+        }
+        r++;
+
+        uint8_t *frame = out->frames[out->count];
+        for (uint8_t bit = 0; bit < 48; bit++, r++)
+        {
+            if (r == run_count || runs[r].marks != 1 ||
+                (runs[r].spaces != 1 && runs[r].spaces != 3))
+            {
+                return "malformed bit";
+            }
+            frame[bit / 8] = (frame[bit / 8] << 1) | (runs[r].spaces == 3);
+        }
+
+        // stop bit: 1T mark, at least 11T space before the next start
+        if (r == run_count || runs[r].marks != 1 || runs[r].spaces < STOP_SPACES)
+        {
+            return "no stop bit";
+        }
+        r++;
+        out->count++;
+    }
+    return NULL;
+}
@@ -0,0 +1,31 @@
+#ifndef __IR_DECODE_H__
+#define __IR_DECODE_H__
+
+#include <stdint.h>
+
+#include "recorder.h"
+
+/**
+ * Receiver side of the Midea protocol, from the recorded LED edges.
+ *
+ * The LED is low during the carrier pulses of a mark and high otherwise,
+ * so a mark is a burst of 21 lows one tick apart and a space stretches
+ * the high between two bursts by 43 ticks. The decoder measures only
+ * the highs, in TIM1 ticks, and checks the start condition, the 48 data
+ * bits and the stop bit of every frame.
+ */
+
+#define IR_DECODE_MAX_FRAMES 8
+
+typedef struct {
+    uint8_t frames[IR_DECODE_MAX_FRAMES][6];
+    uint8_t count;
+} IrDecoded;
+
+/**
+ * Decode the edges, returns NULL on success or what was wrong
+ */
+const char *ir_decode(const RecorderEdge *edges, uint32_t count,
+                      uint32_t tick_cycles, IrDecoded *out);
+
+#endif /* __IR_DECODE_H__ */
@@ -0,0 +1,88 @@
+/*
+ * Record the LED of one transmission to stdout, as CSV or VCD.
+ *
+ *   ir_record [--vcd] deflector
+ *   ir_record [--vcd] off
+ *   ir_record [--vcd] cool|heat|auto|fan <fan level> <temperature>
+ */
+#include "hal_stub.h"
+#include "midea_ir.h"
+#include "recorder.h"
+#include <stdlib.h>
+#include <string.h>
+
+static bool idle(void)
+{
+    return !midea_ir_busy();
+}
+
+static int usage(void)
+{
+    fprintf(stderr, "usage: ir_record [--vcd] deflector | off | "
+                    "cool|heat|auto|fan <fan level> <temperature>\n");
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        const char *name;
+        MideaMode mode;
+    } modes[] = {
+        {"cool", MODE_COOL}, {"heat", MODE_HEAT}, {"auto", MODE_AUTO}, {"fan", MODE_FAN},
+    };
+    bool vcd = argc > 1 && !strcmp(argv[1], "--vcd");
+    MideaIR ir;
+
+    argv += vcd;
+    argc -= vcd;
+    if (argc < 2)
+    {
+        return usage();
+    }
+
+    host_init();
+    recorder_watch(IR_LED_GPIO_Port, IR_LED_Pin);
+    midea_ir_init(&ir);
+
+    if (!strcmp(argv[1], "deflector"))
+    {
+        midea_ir_move_deflector(&ir);
+    }
+    else if (!strcmp(argv[1], "off"))
+    {
+        midea_ir_send(&ir);
+    }
+    else
+    {
+        uint8_t m = 0;
+        while (m < 4 && strcmp(argv[1], modes[m].name))
+        {
+            m++;
+        }
+        if (m == 4 || argc != 4)
+        {
+            return usage();
+        }
+        ir.enabled = true;
+        ir.mode = modes[m].mode;
+        ir.fan_level = atoi(argv[2]);
+        ir.temperature = atoi(argv[3]);
+        midea_ir_send(&ir);
+    }
+
+    if (!host_run_until(idle, 100000000))
+    {
+        fprintf(stderr, "ir_record: frame never ended\n");
+        return 1;
+    }
+    if (vcd)
+    {
+        recorder_write_vcd(stdout, "ir_led");
+    }
+    else
+    {
+        recorder_write_csv(stdout);
+    }
+    return 0;
+}
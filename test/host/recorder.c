@@ -0,0 +1,99 @@
+#include "recorder.h"
+#include "host.h"
+#include <stdlib.h>
+
+#define PS_PER_CYCLE 31250 // at 32MHz
+
+static RecorderEdge edges[RECORDER_CAPACITY];
+static uint32_t count;
+static GPIO_TypeDef *watched_port;
+static uint16_t watched_pin;
+
+void host_pin_changed(GPIO_TypeDef *port, uint16_t pin, bool level)
+{
+    if (port != watched_port || pin != watched_pin)
+    {
+        return;
+    }
+    if (count == RECORDER_CAPACITY)
+    {
+        fprintf(stderr, "recorder: too many edges\n");
+        abort();
+    }
+    edges[count].cycle = host_now;
+    edges[count].level = level;
+    count++;
+}
+
+void recorder_watch(GPIO_TypeDef *port, uint16_t pin)
+{
+    watched_port = port;
+    watched_pin = pin;
+    count = 0;
+}
+
+void recorder_clear(void)
+{
+    count = 0;
+}
+
+uint32_t recorder_count(void)
+{
+    return count;
+}
+
+const RecorderEdge *recorder_edges(void)
+{
+    return edges;
+}
+
+void recorder_write_csv(FILE *out)
+{
+    fprintf(out, "cycle,time_ns,level\n");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fprintf(out, "%llu,%llu,%d\n", (unsigned long long)edges[i].cycle,
+                (unsigned long long)(edges[i].cycle * PS_PER_CYCLE / 1000),
+                edges[i].level);
+    }
+}
+
+void recorder_write_vcd(FILE *out, const char *signal)
+{
+    fprintf(out, "$timescale 1ps $end\n");
+    fprintf(out, "$scope module host $end\n");
+    fprintf(out, "$var wire 1 ! %s $end\n", signal);
+    fprintf(out, "$upscope $end\n");
+    fprintf(out, "$enddefinitions $end\n");
+    fprintf(out, "#0\n$dumpvars\n0!\n$end\n");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        fprintf(out, "#%llu\n%d!\n",
+                (unsigned long long)(edges[i].cycle * PS_PER_CYCLE), edges[i].level);
+    }
+}
+
+int32_t recorder_read_csv(FILE *in, RecorderEdge *out, uint32_t capacity)
+{
+    char line[80];
+    uint32_t n = 0;
+
+    if (!fgets(line, sizeof(line), in))
+    {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), in))
+    {
+        unsigned long long cycle, ns;
+        int level;
+
+        if (n == capacity || sscanf(line, "%llu,%llu,%d", &cycle, &ns, &level) != 3)
+        {
+            return -1;
+        }
+        out[n].cycle = cycle;
+        out[n].level = level;
+        n++;
+    }
+    return n;
+}
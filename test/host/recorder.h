@@ -0,0 +1,43 @@
+#ifndef __RECORDER_H__
+#define __RECORDER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "main.h"
+
+/**
+ * Edge recorder of one output pin.
+ *
+ * Every change of the watched pin is stored with the virtual time it
+ * happened at, and can be written as CSV (cycle, time in ns, level) or
+ * as a VCD for a waveform viewer like GTKWave.
+ */
+
+#define RECORDER_CAPACITY 65536
+
+typedef struct {
+    uint64_t cycle; // host_now of the change
+    bool level;
+} RecorderEdge;
+
+/**
+ * Record the given pin from now on, drops the edges recorded so far
+ */
+void recorder_watch(GPIO_TypeDef *port, uint16_t pin);
+void recorder_clear(void);
+
+uint32_t recorder_count(void);
+const RecorderEdge *recorder_edges(void);
+
+void recorder_write_csv(FILE *out);
+void recorder_write_vcd(FILE *out, const char *signal);
+
+/**
+ * Read edges written by recorder_write_csv(), returns the edge count or
+ * -1 on a malformed file
+ */
+int32_t recorder_read_csv(FILE *in, RecorderEdge *edges, uint32_t capacity);
+
+#endif /* __RECORDER_H__ */
@@ -0,0 +1,43 @@
+/*
+ * Host build: the compiler macros of CMSIS for the host gcc, and the core
+ * intrinsics mapped to the model of host.c.
+ */
+#ifndef __CMSIS_COMPILER_H
+#define __CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+#define __ASM __asm
+#define __INLINE inline
+#define __STATIC_INLINE static inline
+#define __STATIC_FORCEINLINE static inline __attribute__((always_inline))
+#define __NO_RETURN __attribute__((noreturn))
+#define __USED __attribute__((used))
+#define __WEAK __attribute__((weak))
+#define __PACKED __attribute__((packed))
+#define __PACKED_STRUCT struct __attribute__((packed))
+#define __PACKED_UNION union __attribute__((packed))
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define __RESTRICT __restrict
+#define __COMPILER_BARRIER() __asm volatile("" ::: "memory")
+
+void host_disable_irq(void);
+void host_enable_irq(void);
+uint32_t host_get_primask(void);
+void host_set_primask(uint32_t primask);
+void host_wfi(void);
+
+static inline void __disable_irq(void) { host_disable_irq(); }
+static inline void __enable_irq(void) { host_enable_irq(); }
+static inline uint32_t __get_PRIMASK(void) { return host_get_primask(); }
+static inline void __set_PRIMASK(uint32_t primask) { host_set_primask(primask); }
+static inline void __WFI(void) { host_wfi(); }
+static inline void __WFE(void) { host_wfi(); }
+static inline void __SEV(void) {}
+static inline void __NOP(void) {}
+static inline void __DSB(void) { __COMPILER_BARRIER(); }
+static inline void __ISB(void) { __COMPILER_BARRIER(); }
+static inline void __DMB(void) { __COMPILER_BARRIER(); }
+static inline uint32_t __REV(uint32_t value) { return __builtin_bswap32(value); }
+
+#endif /* __CMSIS_COMPILER_H */
@@ -0,0 +1,11 @@
+/*
+ * Host build: the CMSIS version header of the ARM toolchain.
+ */
+#ifndef __CMSIS_VERSION_H
+#define __CMSIS_VERSION_H
+
+#define __CM_CMSIS_VERSION_MAIN (5U)
+#define __CM_CMSIS_VERSION_SUB  (1U)
+#define __CM_CMSIS_VERSION      ((__CM_CMSIS_VERSION_MAIN << 16U) | __CM_CMSIS_VERSION_SUB)
+
+#endif /* __CMSIS_VERSION_H */
@@ -0,0 +1,30 @@
+/*
+ * Host build: the real main.h, then the peripherals are moved from their
+ * bus addresses to the model of host.c.
+ */
+#ifndef __HOST_MAIN_H__
+#define __HOST_MAIN_H__
+
+#include_next "main.h"
+#include "host.h"
+
+#undef TIM1
+#define TIM1 (host_tim1())
+#undef TIM14
+#define TIM14 (host_tim14())
+#undef TIM16
+#define TIM16 (host_tim16())
+#undef SPI1
+#define SPI1 (host_spi1())
+#undef GPIOA
+#define GPIOA (host_gpioa())
+#undef GPIOB
+#define GPIOB (host_gpiob())
+#undef SysTick
+#define SysTick (host_systick())
+#undef SCB
+#define SCB (host_scb())
+#undef RCC
+#define RCC (host_rcc())
+
+#endif /* __HOST_MAIN_H__ */
@@ -0,0 +1,88 @@
+/*
+ * CPU time shares of a nearly idle scheduler, built with CPU_TIME. The
+ * idle timer is stopped under disabled interrupts, after the SysTick
+ * period that woke the core ended: its held back reload must be counted,
+ * or every wake-up loses a millisecond and the idle share wraps.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "scheduler.h"
+#include "cpu_time.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REPORT_MS 1000
+
+int check_failures;
+
+static void blink_run(void)
+{
+    host_advance(2000);
+}
+
+static SchedulerTask blink_task = SCHEDULER_TASK("blink", blink_run, 10);
+
+// shares of the report in permille, CPU_STATES of them
+static void parse_report(const char *report, uint32_t *permille)
+{
+    const char *p = strchr(report, ':');
+
+    for (uint8_t i = 0; i < CPU_STATES; i++)
+    {
+        char *end;
+
+        p = p ? strchr(p + 1, ' ') : NULL;
+        p = p ? strchr(p + 1, ' ') : NULL;
+        CHECK(p, "share %u missing in \"%s\"", i, report);
+        if (!p)
+        {
+            permille[i] = 0;
+            continue;
+        }
+        permille[i] = strtoul(p + 1, &end, 10) * 10;
+        if (*end == '.')
+        {
+            permille[i] += strtoul(end + 1, &end, 10);
+        }
+    }
+}
+
+static void report_run(void)
+{
+    static char report[256];
+    uint32_t permille[CPU_STATES];
+    uint32_t total = 0;
+    FILE *out = stdout;
+
+    stdout = fmemopen(report, sizeof(report), "w");
+    cpu_time_report();
+    fclose(stdout);
+    stdout = out;
+    printf("%s", report);
+
+    parse_report(report, permille);
+    for (uint8_t i = 0; i < CPU_STATES; i++)
+    {
+        CHECK(permille[i] <= 1000, "share %u is %u.%u%%", i, permille[i] / 10, permille[i] % 10);
+        total += permille[i];
+    }
+    // each share is rounded down
+    CHECK(total <= 1000 && total >= 1000 - CPU_STATES, "shares sum to %u.%u%%", total / 10,
+          total % 10);
+    CHECK(permille[CPU_IDLE] >= 950, "idle %u.%u%% with a 2000 cycle task every 10ms",
+          permille[CPU_IDLE] / 10, permille[CPU_IDLE] % 10);
+
+    exit(check_result());
+}
+
+static SchedulerTask report_task = SCHEDULER_TASK("report", report_run, 0);
+
+int main(void)
+{
+    host_init();
+    HAL_InitTick(0);
+
+    scheduler_add(&blink_task, 0);
+    scheduler_add(&report_task, REPORT_MS);
+    scheduler_run();
+}
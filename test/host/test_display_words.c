@@ -0,0 +1,87 @@
+/*
+ * Word tables of display.c against the digit conversion of the original
+ * firmware: every value goes through DisplayDecimal() and DisplayHex(),
+ * and the word put on SPI1 must be the one the original sent.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "display.h"
+
+int check_failures;
+
+/* Original conversion */
+
+static const uint8_t pattern[17] = {
+    0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+    0x7F, 0x6F, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71, 0x00,
+};
+
+// the bytes as HAL_SPI_Transmit() read them for one 16 bit frame
+static uint16_t frame_of(const uint8_t bytes[2])
+{
+    return bytes[0] | bytes[1] << 8;
+}
+
+static uint16_t original_decimal(uint8_t value)
+{
+    uint8_t bcd[2] = {0, value};
+    while (bcd[1] >= 10)
+    {
+        bcd[1] -= 10;
+        bcd[0]++;
+        if (bcd[0] >= 10)
+        {
+            bcd[0] -= 10;
+        }
+    }
+    bcd[1] = 0xFF - pattern[bcd[1]];
+    bcd[0] = 0xFF - pattern[bcd[0]];
+    return frame_of(bcd);
+}
+
+static uint16_t original_hex(uint8_t value)
+{
+    uint8_t data[2] = {
+        0xFF - pattern[(value >> 4) & 0x0F],
+        0xFF - pattern[value & 0x0F],
+    };
+    return frame_of(data);
+}
+
+/* Sent words */
+
+static void check_sent(void (*show)(uint8_t), uint8_t value, uint16_t expected,
+                       const char *what)
+{
+    DisplayOff(); // every value differs from the one before and is sent
+    while (host_spi_dma_complete())
+    {
+    }
+
+    uint32_t before = host_spi_count();
+    show(value);
+    while (host_spi_dma_complete())
+    {
+    }
+
+    CHECK(host_spi_count() == before + 1, "%s(%u): %u frames sent", what, value,
+          host_spi_count() - before);
+    if (host_spi_count() > before)
+    {
+        uint16_t sent = host_spi_frames()[host_spi_count() - 1].frame;
+        CHECK(sent == expected, "%s(%u): %04X instead of %04X", what, value, sent, expected);
+    }
+}
+
+int main(void)
+{
+    host_init();
+
+    for (uint16_t value = 0; value <= 255; value++)
+    {
+        check_sent(DisplayDecimal, value, original_decimal(value), "DisplayDecimal");
+        check_sent(DisplayHex, value, original_hex(value), "DisplayHex");
+    }
+
+    return check_result();
+}
@@ -0,0 +1,63 @@
+/*
+ * Cycle counts of the interrupt engine, built with MIDEA_IR_ISR_BENCH,
+ * MIDEA_IR_ISR_LATENCY and CPU_TIME: frames queued back to back make
+ * the last tick of one frame start the next, which resets TIM1.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "midea_ir.h"
+
+#define FRAME_TICKS (172 * 43) // deflector: 172 pulses of 43 ticks
+
+int check_failures;
+
+static MideaIRLatency latencies[4];
+static uint8_t frames_sent;
+
+void midea_ir_sent_callback(void)
+{
+    if (frames_sent < 4)
+    {
+        midea_ir_latency(&latencies[frames_sent]);
+    }
+    frames_sent++;
+}
+
+static bool idle(void)
+{
+    return !midea_ir_busy();
+}
+
+int main(void)
+{
+    MideaIR ir;
+    MideaIRBench bench;
+
+    host_init();
+    midea_ir_init(&ir);
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        midea_ir_move_deflector(&ir);
+    }
+    CHECK(host_run_until(idle, 4ULL * FRAME_TICKS * 422 * 2), "frames never ended");
+    CHECK(frames_sent == 4, "%u frames sent", frames_sent);
+
+    midea_ir_bench(&bench);
+    printf("max %u cycles, exit at %u, budget %u, %u cycles in all\n", bench.max_cycles,
+           bench.max_exit, bench.budget, midea_ir_isr_cycles());
+    CHECK(bench.budget == 422, "budget %u", bench.budget);
+    CHECK(bench.max_cycles < bench.budget / 4, "max %u cycles", bench.max_cycles);
+    CHECK(bench.max_exit < bench.budget / 4, "exit at %u", bench.max_exit);
+    CHECK(midea_ir_isr_cycles() < 4 * FRAME_TICKS * (uint32_t)bench.max_cycles,
+          "%u cycles for %u ticks", midea_ir_isr_cycles(), 4 * FRAME_TICKS);
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        CHECK(latencies[i].ticks == FRAME_TICKS, "frame %u: %u ticks", i, latencies[i].ticks);
+        CHECK(latencies[i].missed == 0 && latencies[i].late == 0, "frame %u: %u missed, %u late",
+              i, latencies[i].missed, latencies[i].late);
+    }
+
+    return check_result();
+}
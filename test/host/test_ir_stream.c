@@ -0,0 +1,134 @@
+/*
+ * MIDEA_IR_STREAM_ENCODER against the pulses[] encoder: midea_ir.c is
+ * built twice, the public names of each build prefixed (see
+ * CMakeLists.txt), and every frame is sent by both on a fresh model and
+ * compared edge for edge.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "midea_ir.h"
+#include "recorder.h"
+#include <string.h>
+
+typedef struct {
+    const char *name;
+    void (*init)(MideaIR *ir);
+    bool (*send)(MideaIR *ir);
+    bool (*move_deflector)(MideaIR *ir);
+    bool (*busy)(void);
+    void (*tim1_handler)(void);
+} Encoder;
+
+#define ENCODER_API(prefix) \
+    void prefix##_midea_ir_init(MideaIR *ir); \
+    bool prefix##_midea_ir_send(MideaIR *ir); \
+    bool prefix##_midea_ir_move_deflector(MideaIR *ir); \
+    bool prefix##_midea_ir_busy(void); \
+    void prefix##_tim1_handler(void);
+#define ENCODER(prefix) { \
+    #prefix, prefix##_midea_ir_init, prefix##_midea_ir_send, \
+    prefix##_midea_ir_move_deflector, prefix##_midea_ir_busy, prefix##_tim1_handler }
+
+ENCODER_API(pulses)
+ENCODER_API(stream)
+
+static const Encoder pulses = ENCODER(pulses);
+static const Encoder stream = ENCODER(stream);
+static const Encoder *encoder;
+
+int check_failures;
+
+static RecorderEdge reference[RECORDER_CAPACITY];
+static uint32_t reference_count;
+
+void TIM1_BRK_UP_TRG_COM_IRQHandler(void)
+{
+    encoder->tim1_handler();
+}
+
+static bool idle(void)
+{
+    return !encoder->busy();
+}
+
+// sends one frame on a fresh model, the edges are left in the recorder
+static void send(const Encoder *with, const MideaIR *state, bool deflector)
+{
+    MideaIR ir;
+
+    encoder = with;
+    host_init();
+    recorder_watch(IR_LED_GPIO_Port, IR_LED_Pin);
+    encoder->init(&ir);
+    ir = *state;
+    if (deflector)
+    {
+        encoder->move_deflector(&ir);
+    }
+    else
+    {
+        encoder->send(&ir);
+    }
+    CHECK(host_run_until(idle, 100000000), "%s: frame never ended", encoder->name);
+}
+
+static void compare(const MideaIR *state, bool deflector)
+{
+    char what[40];
+
+    if (deflector || !state->enabled)
+    {
+        snprintf(what, sizeof(what), deflector ? "deflector" : "off");
+    }
+    else
+    {
+        snprintf(what, sizeof(what), "mode %d fan %u %uC", state->mode,
+                 state->fan_level, state->temperature);
+    }
+
+    send(&pulses, state, deflector);
+    reference_count = recorder_count();
+    memcpy(reference, recorder_edges(), reference_count * sizeof(*reference));
+    CHECK(reference_count > 0, "%s: nothing sent", what);
+
+    send(&stream, state, deflector);
+    const RecorderEdge *edges = recorder_edges();
+    CHECK(recorder_count() == reference_count, "%s: %u edges instead of %u", what,
+          recorder_count(), reference_count);
+    for (uint32_t i = 0; i < reference_count && i < recorder_count(); i++)
+    {
+        if (edges[i].cycle != reference[i].cycle || edges[i].level != reference[i].level)
+        {
+            CHECK(false, "%s: edge %u at %llu to %d instead of %llu to %d", what, i,
+                  (unsigned long long)edges[i].cycle, edges[i].level,
+                  (unsigned long long)reference[i].cycle, reference[i].level);
+            break;
+        }
+    }
+}
+
+int main(void)
+{
+    static const MideaMode modes[] = {MODE_COOL, MODE_HEAT, MODE_AUTO, MODE_FAN};
+    MideaIR state = {0};
+
+    compare(&state, true);
+    compare(&state, false); // off
+
+    state.enabled = true;
+    for (uint8_t m = 0; m < 4; m++)
+    {
+        for (uint8_t fan = 0; fan < 4; fan++)
+        {
+            for (uint8_t temp = TEMP_LOW - 1; temp <= TEMP_HIGH + 1; temp++)
+            {
+                state.mode = modes[m];
+                state.fan_level = fan;
+                state.temperature = temp;
+                compare(&state, false);
+            }
+        }
+    }
+
+    return check_result();
+}
@@ -0,0 +1,248 @@
+/*
+ * Frame table against the packing of the original firmware: every frame
+ * is sent, decoded from the LED and compared with what pack_data() and
+ * add_complementary_bytes() built for the same state.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "midea_ir.h"
+#include "ir_decode.h"
+#include <string.h>
+
+#define TICK_CYCLES 422 // TIM1 ARR 421
+
+int check_failures;
+
+/* Original encoding */
+
+typedef struct
+{
+    uint8_t magic; // 0xB2 always
+    uint8_t state : 4;
+    uint8_t fan : 4;
+    uint8_t command : 4;
+    uint8_t temp : 4;
+} DataPacket;
+
+static const uint8_t temperature_table[] = {
+    0b0000, 0b0001, 0b0011, 0b0010, 0b0110, 0b0111, 0b0101,
+    0b0100, 0b1100, 0b1101, 0b1001, 0b1000, 0b1010, 0b1011,
+};
+
+static const uint8_t fan_table[] = {0b1011, 0b1001, 0b0101, 0b0011};
+
+static void pack_data(const MideaIR *ir, DataPacket *data)
+{
+    data->magic = 0xB2;
+    if (ir->enabled)
+    {
+        if (ir->mode == MODE_AUTO)
+        {
+            data->fan = 0b0001;
+        }
+        else
+        { // the original did not check the level, out of range is sent as 0
+            data->fan = fan_table[ir->fan_level < 4 ? ir->fan_level : 0];
+        }
+        data->state = 0b1111;
+        data->command = ir->mode;
+
+        if (ir->mode == MODE_FAN)
+        {
+            data->temp = 0b1110;
+        }
+        else if (ir->temperature >= TEMP_LOW && ir->temperature <= TEMP_HIGH)
+        {
+            data->temp = temperature_table[ir->temperature - TEMP_LOW];
+        }
+        else
+        {
+            data->temp = 0b0100;
+        }
+    }
+    else
+    {
+        data->fan = 0b0111;
+        data->state = 0b1011;
+        data->command = 0b0000;
+        data->temp = 0b1110;
+    }
+}
+
+static void add_complementary_bytes(const uint8_t *src, uint8_t *dst)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        *dst++ = *src;
+        *dst++ = ~*src++;
+    }
+}
+
+/* Sent frames */
+
+static bool idle(void)
+{
+    return !midea_ir_busy();
+}
+
+static void check_sent(MideaIR *ir, bool deflector, const uint8_t expected[6],
+                       uint8_t repeat, const char *what)
+{
+    IrDecoded decoded;
+
+    recorder_clear();
+    if (deflector)
+    {
+        midea_ir_move_deflector(ir);
+    }
+    else
+    {
+        midea_ir_send(ir);
+    }
+    CHECK(host_run_until(idle, 100000000), "%s: frame never ended", what);
+
+    const char *error = ir_decode(recorder_edges(), recorder_count(), TICK_CYCLES, &decoded);
+    CHECK(!error, "%s: %s", what, error);
+    CHECK(decoded.count == repeat, "%s: %u frames instead of %u", what, decoded.count, repeat);
+    for (uint8_t i = 0; i < decoded.count && i < repeat; i++)
+    {
+        const uint8_t *frame = decoded.frames[i];
+        CHECK(!memcmp(frame, expected, 6),
+              "%s: %02X %02X %02X %02X %02X %02X instead of %02X %02X %02X %02X %02X %02X",
+              what, frame[0], frame[1], frame[2], frame[3], frame[4], frame[5],
+              expected[0], expected[1], expected[2], expected[3], expected[4], expected[5]);
+    }
+}
+
+static void check_state(MideaIR *ir)
+{
+    DataPacket packet;
+    uint8_t expected[6];
+    char what[40];
+
+    pack_data(ir, &packet);
+    add_complementary_bytes((const uint8_t *)&packet, expected);
+    if (ir->enabled)
+    {
+        snprintf(what, sizeof(what), "mode %d fan %u %uC", ir->mode, ir->fan_level,
+                 ir->temperature);
+    }
+    else
+    {
+        snprintf(what, sizeof(what), "off");
+    }
+    check_sent(ir, false, expected, 2, what);
+}
+
+static void expect(const IrDecoded *decoded, uint8_t i, const uint8_t expected[6],
+                   const char *what)
+{
+    CHECK(i < decoded->count && !memcmp(decoded->frames[i], expected, 6),
+          "%s: frame %u is not the one queued", what, i);
+}
+
+/* Queue: a newer state replaces a waiting state, deflector moves stay */
+
+static void check_queue(MideaIR *ir)
+{
+    static const uint8_t deflector[3] = {0xB2, 0x0F, 0xE0};
+    uint8_t moved[6];
+    uint8_t first[6];
+    uint8_t last[6];
+    DataPacket packet;
+    IrDecoded decoded;
+    const char *error;
+
+    add_complementary_bytes(deflector, moved);
+    ir->enabled = true;
+    ir->mode = MODE_COOL;
+    ir->fan_level = 1;
+    ir->temperature = 20;
+    pack_data(ir, &packet);
+    add_complementary_bytes((const uint8_t *)&packet, first);
+
+    // the first state goes out, the second is replaced by the third
+    recorder_clear();
+    CHECK(midea_ir_send(ir), "state: not sent");
+    ir->temperature = 21;
+    CHECK(midea_ir_send(ir), "state: not queued");
+    ir->temperature = 22;
+    CHECK(midea_ir_send(ir), "state: not merged");
+    pack_data(ir, &packet);
+    add_complementary_bytes((const uint8_t *)&packet, last);
+    CHECK(host_run_until(idle, 100000000), "state: queue never drained");
+    error = ir_decode(recorder_edges(), recorder_count(), TICK_CYCLES, &decoded);
+    CHECK(!error, "state: %s", error);
+    CHECK(decoded.count == 4, "state: %u frames instead of 4", decoded.count);
+    expect(&decoded, 0, first, "state");
+    expect(&decoded, 1, first, "state");
+    expect(&decoded, 2, last, "state");
+    expect(&decoded, 3, last, "state");
+
+    // a full queue of deflector moves rejects the state, no move is lost
+    recorder_clear();
+    ir->temperature = 20;
+    CHECK(midea_ir_send(ir), "full: not sent");
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        CHECK(midea_ir_move_deflector(ir), "full: move %u not queued", i);
+    }
+    ir->temperature = 22;
+    CHECK(!midea_ir_send(ir), "full: state accepted by a full queue");
+    CHECK(!midea_ir_move_deflector(ir), "full: move accepted by a full queue");
+    CHECK(host_run_until(idle, 100000000), "full: queue never drained");
+    error = ir_decode(recorder_edges(), recorder_count(), TICK_CYCLES, &decoded);
+    CHECK(!error, "full: %s", error);
+    CHECK(decoded.count == 6, "full: %u frames instead of 6", decoded.count);
+    expect(&decoded, 0, first, "full");
+    expect(&decoded, 1, first, "full");
+    for (uint8_t i = 2; i < 6; i++)
+    {
+        expect(&decoded, i, moved, "full");
+    }
+}
+
+int main(void)
+{
+    static const MideaMode modes[] = {MODE_COOL, MODE_HEAT, MODE_AUTO, MODE_FAN};
+    static const uint8_t deflector[3] = {0xB2, 0x0F, 0xE0};
+    static const uint8_t fans_out_of_range[] = {4, 15, 255};
+    uint8_t expected[6];
+    MideaIR ir;
+
+    host_init();
+    recorder_watch(IR_LED_GPIO_Port, IR_LED_Pin);
+    midea_ir_init(&ir);
+
+    add_complementary_bytes(deflector, expected);
+    check_sent(&ir, true, expected, 1, "deflector");
+
+    check_state(&ir); // off
+
+    ir.enabled = true;
+    for (uint8_t m = 0; m < 4; m++)
+    {
+        ir.mode = modes[m];
+        for (ir.fan_level = 0; ir.fan_level < 4; ir.fan_level++)
+        {
+            for (ir.temperature = 0; ir.temperature <= TEMP_HIGH + 2; ir.temperature++)
+            {
+                if (ir.temperature && ir.temperature < TEMP_LOW - 1)
+                {
+                    continue; // 0 and one below the range are enough
+                }
+                check_state(&ir);
+            }
+        }
+        ir.temperature = 24;
+        for (uint8_t f = 0; f < sizeof(fans_out_of_range); f++)
+        {
+            ir.fan_level = fans_out_of_range[f];
+            check_state(&ir);
+        }
+    }
+
+    check_queue(&ir);
+
+    return check_result();
+}
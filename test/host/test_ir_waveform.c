@@ -0,0 +1,83 @@
+/*
+ * Frames sent by the interrupt engine on the virtual TIM1, decoded from
+ * the LED edges like a receiver would.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "midea_ir.h"
+#include "ir_decode.h"
+#include <string.h>
+
+#define TICK_CYCLES 422 // TIM1 ARR 421
+#define FRAME_LIMIT (TICK_CYCLES * 43 * 240 * 3)
+
+int check_failures;
+
+static bool idle(void)
+{
+    return !midea_ir_busy();
+}
+
+static void expect(const IrDecoded *decoded, uint8_t count, const uint8_t frame[6])
+{
+    CHECK(decoded->count == count, "%u frames instead of %u", decoded->count, count);
+    for (uint8_t i = 0; i < decoded->count && i < count; i++)
+    {
+        CHECK(!memcmp(decoded->frames[i], frame, 6),
+              "frame %u: %02X %02X %02X %02X %02X %02X", i,
+              decoded->frames[i][0], decoded->frames[i][1], decoded->frames[i][2],
+              decoded->frames[i][3], decoded->frames[i][4], decoded->frames[i][5]);
+    }
+}
+
+static void send(MideaIR *ir, bool deflector, IrDecoded *decoded)
+{
+    recorder_clear();
+    if (deflector)
+    {
+        midea_ir_move_deflector(ir);
+    }
+    else
+    {
+        midea_ir_send(ir);
+    }
+    CHECK(host_run_until(idle, FRAME_LIMIT), "frame never ended");
+
+    const char *error = ir_decode(recorder_edges(), recorder_count(), TICK_CYCLES, decoded);
+    CHECK(!error, "%s", error);
+}
+
+int main(void)
+{
+    MideaIR ir;
+    IrDecoded decoded;
+
+    host_init();
+    recorder_watch(IR_LED_GPIO_Port, IR_LED_Pin);
+    midea_ir_init(&ir);
+
+    // deflector: sent once
+    send(&ir, true, &decoded);
+    expect(&decoded, 1, (const uint8_t[]){0xB2, 0x4D, 0x0F, 0xF0, 0xE0, 0x1F});
+
+    // 24 ones and 24 zeros: 16 + 24 * 4 + 24 * 2 + 12 pulses of 43 ticks, the
+    // first edge is one tick in and the LED goes idle on the step tick of
+    // the last pulse
+    const RecorderEdge *edges = recorder_edges();
+    uint64_t ticks = (edges[recorder_count() - 1].cycle - edges[0].cycle +
+                      TICK_CYCLES / 2) / TICK_CYCLES;
+    CHECK(ticks == 172 * 43 - 2, "deflector frame lasts %llu ticks",
+          (unsigned long long)ticks);
+
+    // automatic 24C: fan irrelevant, sent twice
+    ir.enabled = true;
+    ir.mode = MODE_AUTO;
+    ir.temperature = 24;
+    send(&ir, false, &decoded);
+    expect(&decoded, 2, (const uint8_t[]){0xB2, 0x4D, 0x1F, 0xE0, 0x48, 0xB7});
+
+    // the LED is off between the frames
+    CHECK(!(IR_LED_GPIO_Port->ODR & IR_LED_Pin), "LED left on");
+
+    return check_result();
+}
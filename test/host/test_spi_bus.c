@@ -0,0 +1,98 @@
+/*
+ * SPI bus queue: transfers submitted from the completion of another one,
+ * and the stream handing the bus over.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "spi_bus.h"
+#include "spi.h"
+
+int check_failures;
+
+static const SpiDevice device = {
+    .cs_port = NULL,
+    .data_size = SPI_DATASIZE_16BIT,
+    .max_hz = 250000,
+};
+
+static uint16_t words[2] = {0x1111, 0x2222};
+static uint8_t resubmits; // left for again_done()
+static uint8_t stream_starts;
+static bool stream_on;
+
+static void again_done(SpiTransfer *transfer);
+
+static SpiTransfer first = {.device = &device, .data = &words[0], .count = 1, .done = again_done};
+static SpiTransfer second = {.device = &device, .data = &words[1], .count = 1};
+
+static void again_done(SpiTransfer *transfer)
+{
+    if (resubmits)
+    {
+        resubmits--;
+        CHECK(spi_bus_submit(transfer), "resubmit refused");
+    }
+}
+
+static void stream_start(void)
+{
+    CHECK(hspi1.State == HAL_SPI_STATE_READY, "stream started with a transfer on the wire");
+    stream_starts++;
+    stream_on = true;
+}
+
+static void stream_stop(void)
+{
+    stream_on = false;
+}
+
+static const SpiStream stream = {.device = &device, .start = stream_start, .stop = stream_stop};
+
+// completes the transfers one by one, each must have put one frame on the wire
+static uint32_t drain(void)
+{
+    uint32_t completions = 0;
+
+    while (host_spi_dma_complete())
+    {
+        completions++;
+        CHECK(host_spi_count() >= completions, "completion without a transfer");
+    }
+    return completions;
+}
+
+int main(void)
+{
+    host_init();
+
+    // a transfer submitting itself again from its completion
+    resubmits = 3;
+    spi_bus_submit(&first);
+    CHECK(!spi_bus_idle(), "bus idle with a transfer on the wire");
+    CHECK(drain() == 4, "not every submit was sent");
+    CHECK(host_spi_count() == 4, "%u frames sent instead of 4", host_spi_count());
+    CHECK(spi_bus_idle() && !first.queued, "queue not empty");
+
+    // queued behind a resubmit, in order
+    resubmits = 1;
+    spi_bus_submit(&first);
+    spi_bus_submit(&second);
+    CHECK(drain() == 3, "not every submit was sent");
+    const HostSpiFrame *frames = host_spi_frames();
+    CHECK(frames[4].frame == 0x1111 && frames[5].frame == 0x2222 && frames[6].frame == 0x1111,
+          "order %04X %04X %04X", frames[4].frame, frames[5].frame, frames[6].frame);
+    CHECK(spi_bus_idle(), "queue not empty");
+
+    // the stream gets the bus only after the last transfer
+    spi_bus_stream(&stream);
+    CHECK(stream_on && stream_starts == 1, "stream not started on an idle bus");
+    resubmits = 2;
+    spi_bus_submit(&first);
+    CHECK(!stream_on, "stream not stopped for a transfer");
+    drain();
+    CHECK(stream_on && stream_starts == 2, "stream not started after the queue");
+    spi_bus_stream(NULL);
+    CHECK(!stream_on, "stream not stopped");
+
+    return check_result();
+}
@@ -0,0 +1,87 @@
+/*
+ * Tickless time base over a virtual hour: random sleeps, half of them
+ * woken early by an external interrupt, which makes the next sleep cut
+ * the stretched SysTick period. The time base must stay within 1ms of
+ * the core cycles really spent.
+ */
+#include "hal_stub.h"
+#include "check.h"
+#include "tickless.h"
+
+#define HOUR_CYCLES (3600ULL * 32000000)
+#define TICK_CYCLES 32000
+
+int check_failures;
+
+static uint32_t seed = 12345;
+
+static uint32_t random_below(uint32_t limit)
+{
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+static void button(void)
+{
+}
+
+int main(void)
+{
+    uint64_t origin;
+    uint32_t sleeps = 0;
+    uint32_t early = 0;
+    int32_t max_drift = 0;
+
+    host_init();
+    HAL_InitTick(0);
+
+    __disable_irq();
+    uint32_t cycles = tickless_cycles();
+    origin = host_now - cycles;
+    __enable_irq();
+
+    while (host_now - origin < HOUR_CYCLES)
+    {
+        uint32_t sleep_ms = 1 + random_below(100);
+        bool wake_early = random_below(2);
+
+        // a task runs, SysTick keeps its 1ms period meanwhile
+        host_advance(random_below(2 * TICK_CYCLES));
+
+        if (wake_early)
+        {
+            host_external_irq(host_now + random_below(sleep_ms * TICK_CYCLES), button);
+        }
+        __disable_irq();
+        tickless_prepare(sleep_ms); // like scheduler_run()
+        __WFI();
+        __enable_irq();
+        host_external_irq(0, NULL);
+        sleeps++;
+
+        __disable_irq();
+        cycles = tickless_cycles();
+        uint64_t elapsed = host_now - origin;
+        uint32_t tick = HAL_GetTick();
+        __enable_irq();
+
+        int32_t drift = (int32_t)(cycles - (uint32_t)elapsed);
+        if (drift > max_drift || -drift > max_drift)
+        {
+            max_drift = drift < 0 ? -drift : drift;
+        }
+        int64_t tick_error = (int64_t)tick - (int64_t)(elapsed / TICK_CYCLES);
+        CHECK(tick_error >= -1 && tick_error <= 1, "HAL_GetTick() %u at %llu cycles", tick,
+              (unsigned long long)elapsed);
+        if (tick_error < -1 || tick_error > 1)
+        {
+            break;
+        }
+        early += wake_early;
+    }
+
+    printf("%u sleeps, %u woken early, drift at most %d cycles\n", sleeps, early, max_drift);
+    CHECK(max_drift < TICK_CYCLES, "drifted %d cycles in an hour", max_drift);
+
+    return check_result();
+}